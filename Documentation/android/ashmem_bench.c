@@ -0,0 +1,275 @@
+/*
+ * ashmem_bench - concurrent ashmem pin/unpin throughput
+ *
+ * Each thread unpins and pins back page ranges of an ashmem area as fast
+ * as it can for a fixed time, and the total number of unpin/pin pairs per
+ * second is reported.  By default every thread has its own area, which is
+ * the case per-area locking is for; -S makes them share one area.  -P adds
+ * a thread that keeps purging all unpinned ranges, as the shrinker would
+ * under memory pressure.  Run it with the same arguments on the kernels
+ * being compared.
+ *
+ * -P purges the caches of every ashmem user on the system and needs
+ * CAP_SYS_ADMIN.
+ *
+ * usage: ashmem_bench [-t threads] [-s seconds] [-n pages] [-r range pages]
+ *		       [-S] [-P]
+ *   -t may be given several times, e.g. -t 1 -t 4 -t 16.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/ashmem.h>
+
+#define MAX_THREADS	256
+#define MAX_RUNS	16
+
+static double run_secs = 5;
+static unsigned int nr_pages = 256, range_pages = 4;
+static int shared, purger;
+static size_t page_size;
+static volatile int go, stop;
+
+struct worker {
+	pthread_t thread;
+	int fd;
+	void *map;		/* set if this thread created the area */
+	unsigned int first;	/* first page this thread works on */
+	unsigned int count;	/* and how many */
+	unsigned long pairs;
+	unsigned long purged;
+	unsigned long failed;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int area_create(size_t size, void **map)
+{
+	char name[ASHMEM_NAME_LEN] = "ashmem_bench";
+	int fd = open("/dev/ashmem", O_RDWR);
+	void *p;
+
+	if (fd < 0) {
+		perror("/dev/ashmem");
+		return -1;
+	}
+	if (ioctl(fd, ASHMEM_SET_NAME, name) < 0 ||
+	    ioctl(fd, ASHMEM_SET_SIZE, size) < 0) {
+		perror("ashmem setup");
+		close(fd);
+		return -1;
+	}
+	/* the area is only backed once it has been mapped */
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		close(fd);
+		return -1;
+	}
+	memset(p, 0x5a, size);
+	*map = p;
+	return fd;
+}
+
+static void *pin_unpin(void *arg)
+{
+	struct worker *w = arg;
+	struct ashmem_pin pin;
+	unsigned int page = 0;
+	int ret;
+
+	while (!go)
+		;
+	while (!stop) {
+		pin.offset = (w->first + page) * page_size;
+		pin.len = range_pages * page_size;
+		if (ioctl(w->fd, ASHMEM_UNPIN, &pin) < 0) {
+			w->failed++;
+			continue;
+		}
+		ret = ioctl(w->fd, ASHMEM_PIN, &pin);
+		if (ret < 0)
+			w->failed++;
+		else {
+			if (ret == ASHMEM_WAS_PURGED)
+				w->purged++;
+			w->pairs++;
+		}
+		page += range_pages;
+		if (page + range_pages > w->count)
+			page = 0;
+	}
+	return NULL;
+}
+
+static void *purge(void *arg)
+{
+	int fd = *(int *)arg;
+
+	while (!go)
+		;
+	while (!stop) {
+		if (ioctl(fd, ASHMEM_PURGE_ALL_CACHES) < 0) {
+			perror("ASHMEM_PURGE_ALL_CACHES");
+			break;
+		}
+		usleep(1000);
+	}
+	return NULL;
+}
+
+static double run(int threads, unsigned long *purged, unsigned long *failed)
+{
+	static struct worker workers[MAX_THREADS];
+	unsigned long pairs = 0;
+	pthread_t purge_thread;
+	double start, secs;
+	size_t size = nr_pages * page_size;
+	int i;
+
+	memset(workers, 0, sizeof(workers));
+	for (i = 0; i < threads; i++) {
+		struct worker *w = &workers[i];
+
+		if (shared && i) {
+			w->fd = workers[0].fd;
+			w->count = workers[0].count;
+			w->first = i * w->count;
+			continue;
+		}
+		w->fd = area_create(size, &w->map);
+		/* a shared area is split, each thread gets its own pages */
+		w->count = shared ? nr_pages / threads : nr_pages;
+		if (w->fd < 0)
+			exit(1);
+	}
+
+	go = stop = 0;
+	for (i = 0; i < threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, pin_unpin,
+				   &workers[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	if (purger && pthread_create(&purge_thread, NULL, purge,
+				     &workers[0].fd)) {
+		perror("pthread_create");
+		exit(1);
+	}
+
+	start = now();
+	go = 1;
+	usleep(run_secs * 1e6);
+	stop = 1;
+	secs = now() - start;
+
+	*purged = *failed = 0;
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		pairs += workers[i].pairs;
+		*purged += workers[i].purged;
+		*failed += workers[i].failed;
+	}
+	if (purger)
+		pthread_join(purge_thread, NULL);
+	for (i = 0; i < threads; i++)
+		if (workers[i].map) {
+			munmap(workers[i].map, size);
+			close(workers[i].fd);
+		}
+	return pairs / secs;
+}
+
+int main(int argc, char **argv)
+{
+	int threads[MAX_RUNS], runs = 0, i, opt;
+	unsigned long purged, failed;
+	double rate;
+
+	while ((opt = getopt(argc, argv, "t:s:n:r:SP")) != -1) {
+		switch (opt) {
+		case 't':
+			if (runs == MAX_RUNS) {
+				fprintf(stderr, "at most %d -t\n", MAX_RUNS);
+				return 1;
+			}
+			threads[runs++] = atoi(optarg);
+			break;
+		case 's':
+			run_secs = atof(optarg);
+			break;
+		case 'n':
+			nr_pages = atoi(optarg);
+			break;
+		case 'r':
+			range_pages = atoi(optarg);
+			break;
+		case 'S':
+			shared = 1;
+			break;
+		case 'P':
+			purger = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t threads] [-s seconds] "
+				"[-n pages] [-r range pages] [-S] [-P]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (!runs) {
+		threads[0] = 1;
+		threads[1] = 4;
+		threads[2] = 16;
+		runs = 3;
+	}
+	for (i = 0; i < runs; i++) {
+		if (threads[i] < 1 || threads[i] > MAX_THREADS) {
+			fprintf(stderr, "threads must be 1..%d\n", MAX_THREADS);
+			return 1;
+		}
+		if (range_pages < 1 ||
+		    range_pages > nr_pages / (shared ? threads[i] : 1)) {
+			fprintf(stderr, "a range must fit in a thread's pages\n");
+			return 1;
+		}
+	}
+	if (run_secs <= 0) {
+		fprintf(stderr, "seconds must be > 0\n");
+		return 1;
+	}
+	page_size = sysconf(_SC_PAGESIZE);
+
+	printf("%s areas of %u pages, %u page ranges%s, %.1f s per run\n",
+	       shared ? "shared" : "per-thread", nr_pages, range_pages,
+	       purger ? ", purging" : "", run_secs);
+	for (i = 0; i < runs; i++) {
+		rate = run(threads[i], &purged, &failed);
+		printf("%3d threads: %10.0f unpin/pin pairs/s", threads[i],
+		       rate);
+		if (purged)
+			printf(", %lu purged", purged);
+		if (failed)
+			printf(" (%lu failed)", failed);
+		printf("\n");
+	}
+	return 0;
+}
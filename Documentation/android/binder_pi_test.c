@@ -0,0 +1,219 @@
+/*
+ * binder_pi_test - foreground binder call latency under background load
+ *
+ * A single-threaded server running at nice 19 spends a fixed amount of
+ * CPU time on every call.  A number of CPU hogs run at nice 0 next to
+ * it, and a foreground client (SCHED_FIFO by default) calls the server
+ * and records how long each call takes.  Everything is pinned to one CPU
+ * so the server really has to compete with the hogs.
+ *
+ * If the server thread inherits the caller's scheduling policy and
+ * priority for the duration of the call, latency stays close to the
+ * server's work time no matter how many hogs run; if only the nice value
+ * is inherited, the server gets a fair share of the CPU at best and the
+ * latency grows with the number of hogs.
+ *
+ * Needs a running servicemanager, root (for SCHED_FIFO and for
+ * registering the service) and RLIMIT_NICE for the server to be raised.
+ *
+ * usage: binder_pi_test [-c calls] [-w work usecs] [-H hogs] [-f rtprio]
+ *			 [-n nice] [-C cpu]
+ *   -f sets a SCHED_FIFO client (default 1), -n a SCHED_NORMAL one.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "binder_test.h"
+
+#define MAP_SIZE	(128 * 1024)
+#define MAX_HOGS	32
+
+static unsigned int work_us = 1000;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		perror("sched_setaffinity");
+}
+
+/* Burns CPU rather than sleeping, so it only progresses when it runs */
+static void spin(unsigned int usecs)
+{
+	struct timespec ts;
+	double end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	end = ts.tv_sec + ts.tv_nsec / 1e9 + usecs / 1e6;
+	do
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	while (ts.tv_sec + ts.tv_nsec / 1e9 < end);
+}
+
+static void work_handler(struct binder_state *bs,
+			 struct binder_transaction_data *txn,
+			 struct bt_parcel *reply)
+{
+	spin(work_us);
+	bt_put_u32(reply, 0);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	int calls = 200, hogs = 4, cpu = 0, rtprio = 1, nice_val = 0;
+	pid_t server, hog[MAX_HOGS];
+	struct binder_transaction_data reply;
+	struct sched_param param;
+	struct binder_state *bs;
+	double *lat, start, sum = 0;
+	uint32_t handle;
+	char name[64];
+	int i, opt, failed = 0;
+
+	while ((opt = getopt(argc, argv, "c:w:H:f:n:C:")) != -1) {
+		switch (opt) {
+		case 'c':
+			calls = atoi(optarg);
+			break;
+		case 'w':
+			work_us = atoi(optarg);
+			break;
+		case 'H':
+			hogs = atoi(optarg);
+			break;
+		case 'f':
+			rtprio = atoi(optarg);
+			break;
+		case 'n':
+			rtprio = 0;
+			nice_val = atoi(optarg);
+			break;
+		case 'C':
+			cpu = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-c calls] [-w work usecs] "
+				"[-H hogs] [-f rtprio] [-n nice] [-C cpu]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (calls < 1 || hogs < 0 || hogs > MAX_HOGS) {
+		fprintf(stderr, "calls must be > 0, hogs 0..%d\n", MAX_HOGS);
+		return 1;
+	}
+	lat = calloc(calls, sizeof(*lat));
+	if (!lat)
+		return 1;
+	pin(cpu);
+
+	snprintf(name, sizeof(name), "binder_pi_test.%d", getpid());
+	server = fork();
+	if (server == 0) {
+		setpriority(PRIO_PROCESS, 0, 19);
+		bs = bt_open(MAP_SIZE);
+		if (!bs || bt_add_service(bs, name, (void *)1L)) {
+			fprintf(stderr, "%s: cannot register\n", name);
+			exit(1);
+		}
+		bt_loop(bs, work_handler);
+	}
+
+	/* before opening binder, so that they do not share the fd */
+	for (i = 0; i < hogs; i++) {
+		hog[i] = fork();
+		if (hog[i] == 0) {
+			setpriority(PRIO_PROCESS, 0, 0);
+			for (;;)
+				spin(1000000);
+		}
+	}
+
+	bs = bt_open(MAP_SIZE);
+	if (!bs)
+		goto out_hogs;
+	for (i = 0; bt_get_service(bs, name, &handle); i++) {
+		if (i == 500) {
+			fprintf(stderr, "%s: service not found\n", name);
+			goto out_hogs;
+		}
+		usleep(10000);
+	}
+
+	if (rtprio) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = rtprio;
+		if (sched_setscheduler(0, SCHED_FIFO, &param)) {
+			perror("sched_setscheduler");
+			goto out_hogs;
+		}
+	} else
+		setpriority(PRIO_PROCESS, 0, nice_val);
+
+	/* let the hogs settle in */
+	usleep(200000);
+	for (i = 0; i < calls; i++) {
+		start = now();
+		if (bt_call(bs, handle, 1, NULL, 0, NULL, 0, &reply)) {
+			failed++;
+			lat[i] = 0;
+		} else {
+			lat[i] = (now() - start) * 1e6;
+			bt_free_buffer(bs, reply.data.ptr.buffer);
+		}
+		sum += lat[i];
+		usleep(5000);
+	}
+
+	qsort(lat, calls, sizeof(*lat), cmp_double);
+	if (rtprio)
+		printf("client SCHED_FIFO %d", rtprio);
+	else
+		printf("client nice %d", nice_val);
+	printf(", server nice 19, %d hogs at nice 0, %u us of work per "
+	       "call\n", hogs, work_us);
+	printf("latency us: min %.0f avg %.0f p50 %.0f p90 %.0f p99 %.0f "
+	       "max %.0f (%d calls, %d failed)\n",
+	       lat[0], sum / calls, lat[calls / 2], lat[calls * 9 / 10],
+	       lat[calls * 99 / 100], lat[calls - 1], calls, failed);
+
+out_hogs:
+	for (i = 0; i < hogs; i++) {
+		kill(hog[i], SIGKILL);
+		waitpid(hog[i], NULL, 0);
+	}
+	kill(server, SIGKILL);
+	waitpid(server, NULL, 0);
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * binder_stress - binder transaction throughput over independent pairs
+ *
+ * Starts N server processes, each publishing one object through the
+ * servicemanager, and N client processes that each hammer their own
+ * server with synchronous calls for a fixed time.  The pairs share
+ * nothing but the driver, so the aggregate rate shows how well binder
+ * transactions between unrelated processes proceed in parallel: run it
+ * with the same arguments on the kernels being compared.
+ *
+ * Needs a running servicemanager and permission to register services
+ * with it (root or system).
+ *
+ * usage: binder_stress [-p pairs] [-t seconds] [-s payload bytes]
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "binder_test.h"
+
+#define MAP_SIZE	(128 * 1024)
+#define MAX_PAIRS	64
+
+struct result {
+	int pair;
+	unsigned long calls;
+	unsigned long failed;
+	double secs;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void echo_handler(struct binder_state *bs,
+			 struct binder_transaction_data *txn,
+			 struct bt_parcel *reply)
+{
+	bt_put_u32(reply, 0);
+}
+
+static void run_server(const char *name, int pair)
+{
+	struct binder_state *bs = bt_open(MAP_SIZE);
+
+	if (!bs)
+		exit(1);
+	if (bt_add_service(bs, name, (void *)(long)(pair + 1))) {
+		fprintf(stderr, "%s: cannot register with servicemanager\n",
+			name);
+		exit(1);
+	}
+	bt_loop(bs, echo_handler);
+}
+
+static void run_client(const char *name, int pair, int go_fd, int res_fd,
+		       double secs, size_t size)
+{
+	struct binder_transaction_data reply;
+	struct binder_state *bs;
+	struct result res;
+	uint32_t handle;
+	double start, end;
+	char *payload, c;
+	int tries;
+
+	bs = bt_open(MAP_SIZE);
+	payload = malloc(size ? size : 1);
+	if (!bs || !payload)
+		exit(1);
+	memset(payload, 0x5a, size);
+
+	for (tries = 0; bt_get_service(bs, name, &handle); tries++) {
+		if (tries == 500) {
+			fprintf(stderr, "%s: service not found\n", name);
+			exit(1);
+		}
+		usleep(10000);
+	}
+
+	/* wait for the starting gun: the parent closes the pipe */
+	while (read(go_fd, &c, 1) < 0 && errno == EINTR)
+		;
+
+	memset(&res, 0, sizeof(res));
+	res.pair = pair;
+	start = now();
+	end = start + secs;
+	for (;;) {
+		if (bt_call(bs, handle, 1, payload, size, NULL, 0, &reply))
+			res.failed++;
+		else {
+			bt_free_buffer(bs, reply.data.ptr.buffer);
+			res.calls++;
+		}
+		if (!(res.calls & 63) && now() >= end)
+			break;
+	}
+	res.secs = now() - start;
+	if (write(res_fd, &res, sizeof(res)) != sizeof(res))
+		exit(1);
+	exit(0);
+}
+
+int main(int argc, char **argv)
+{
+	pid_t servers[MAX_PAIRS], clients[MAX_PAIRS];
+	int pairs = 4, go[2], res[2], i, opt;
+	double secs = 10, total = 0;
+	size_t size = 128;
+	unsigned long failed = 0;
+	struct result r;
+	char name[64];
+
+	while ((opt = getopt(argc, argv, "p:t:s:")) != -1) {
+		switch (opt) {
+		case 'p':
+			pairs = atoi(optarg);
+			break;
+		case 't':
+			secs = atof(optarg);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-p pairs] [-t seconds] "
+				"[-s payload bytes]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (pairs < 1 || pairs > MAX_PAIRS || secs <= 0) {
+		fprintf(stderr, "pairs must be 1..%d, seconds > 0\n",
+			MAX_PAIRS);
+		return 1;
+	}
+	if (pipe(go) || pipe(res)) {
+		perror("pipe");
+		return 1;
+	}
+
+	for (i = 0; i < pairs; i++) {
+		snprintf(name, sizeof(name), "binder_stress.%d.%d",
+			 getpid(), i);
+		servers[i] = fork();
+		if (servers[i] == 0)
+			run_server(name, i);
+		clients[i] = fork();
+		if (clients[i] == 0) {
+			close(go[1]);
+			close(res[0]);
+			run_client(name, i, go[0], res[1], secs, size);
+		}
+	}
+	close(go[0]);
+	close(res[1]);
+
+	printf("%d pairs, %zu byte payload, %.1f s\n", pairs, size, secs);
+	close(go[1]);
+	for (i = 0; i < pairs; i++) {
+		if (read(res[0], &r, sizeof(r)) != sizeof(r)) {
+			fprintf(stderr, "a client failed\n");
+			break;
+		}
+		printf("pair %2d: %10.0f calls/s\n", r.pair, r.calls / r.secs);
+		total += r.calls / r.secs;
+		failed += r.failed;
+	}
+	printf("total:   %10.0f calls/s, %lu failed\n", total, failed);
+
+	for (i = 0; i < pairs; i++) {
+		kill(servers[i], SIGKILL);
+		waitpid(servers[i], NULL, 0);
+		waitpid(clients[i], NULL, 0);
+	}
+	return 0;
+}
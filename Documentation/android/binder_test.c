@@ -0,0 +1,381 @@
+/*
+ * Minimal binder client/server helpers for the binder test programs
+ *
+ * Just enough of the binder protocol to publish an object through the
+ * servicemanager, look it up from another process and make synchronous
+ * calls on it; see frameworks/base/cmds/servicemanager for the full thing.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "binder_test.h"
+
+#define SVC_MGR_HANDLE		0
+#define SVC_MGR_CHECK_SERVICE	2
+#define SVC_MGR_ADD_SERVICE	3
+
+static const char svcmgr_id[] = "android.os.IServiceManager";
+
+struct binder_state *bt_open(size_t mapsize)
+{
+	struct binder_state *bs;
+	struct binder_version vers;
+
+	bs = malloc(sizeof(*bs));
+	if (!bs)
+		return NULL;
+
+	bs->fd = open("/dev/binder", O_RDWR);
+	if (bs->fd < 0) {
+		perror("open /dev/binder");
+		goto fail_open;
+	}
+	if (ioctl(bs->fd, BINDER_VERSION, &vers) < 0 ||
+	    vers.protocol_version != BINDER_CURRENT_PROTOCOL_VERSION) {
+		fprintf(stderr, "binder: driver protocol version mismatch\n");
+		goto fail_map;
+	}
+
+	bs->mapsize = mapsize;
+	bs->mapped = mmap(NULL, mapsize, PROT_READ, MAP_PRIVATE, bs->fd, 0);
+	if (bs->mapped == MAP_FAILED) {
+		perror("mmap /dev/binder");
+		goto fail_map;
+	}
+	return bs;
+
+fail_map:
+	close(bs->fd);
+fail_open:
+	free(bs);
+	return NULL;
+}
+
+void bt_close(struct binder_state *bs)
+{
+	munmap(bs->mapped, bs->mapsize);
+	close(bs->fd);
+	free(bs);
+}
+
+void bt_init(struct bt_parcel *p)
+{
+	p->len = 0;
+	p->nr_offs = 0;
+}
+
+void bt_put_u32(struct bt_parcel *p, uint32_t v)
+{
+	if (p->len + sizeof(v) > sizeof(p->data))
+		abort();
+	memcpy(p->data + p->len, &v, sizeof(v));
+	p->len += sizeof(v);
+}
+
+/* Parcel strings are a length followed by NUL terminated UTF-16 */
+void bt_put_string16(struct bt_parcel *p, const char *s)
+{
+	size_t len = strlen(s), i;
+	uint16_t c;
+
+	bt_put_u32(p, len);
+	if (p->len + (len + 1) * sizeof(c) + 3 > sizeof(p->data))
+		abort();
+	for (i = 0; i <= len; i++) {
+		c = (unsigned char)s[i];
+		memcpy(p->data + p->len, &c, sizeof(c));
+		p->len += sizeof(c);
+	}
+	while (p->len & 3)
+		p->data[p->len++] = 0;
+}
+
+void bt_put_binder(struct bt_parcel *p, void *ptr)
+{
+	struct flat_binder_object obj;
+
+	if (p->len + sizeof(obj) > sizeof(p->data) ||
+	    p->nr_offs == sizeof(p->offs) / sizeof(p->offs[0]))
+		abort();
+	memset(&obj, 0, sizeof(obj));
+	obj.type = BINDER_TYPE_BINDER;
+	obj.flags = 0x7f | FLAT_BINDER_FLAG_ACCEPTS_FDS;
+	obj.binder = ptr;
+	obj.cookie = ptr;
+	p->offs[p->nr_offs++] = p->len;
+	memcpy(p->data + p->len, &obj, sizeof(obj));
+	p->len += sizeof(obj);
+}
+
+static int bt_write(struct binder_state *bs, const void *data, size_t len)
+{
+	struct binder_write_read bwr;
+
+	memset(&bwr, 0, sizeof(bwr));
+	bwr.write_size = len;
+	bwr.write_buffer = (unsigned long)data;
+	if (ioctl(bs->fd, BINDER_WRITE_READ, &bwr) < 0) {
+		perror("binder write");
+		return -1;
+	}
+	return 0;
+}
+
+void bt_free_buffer(struct binder_state *bs, const void *buffer)
+{
+	struct {
+		uint32_t cmd;
+		const void *buffer;
+	} __attribute__((packed)) data;
+
+	data.cmd = BC_FREE_BUFFER;
+	data.buffer = buffer;
+	bt_write(bs, &data, sizeof(data));
+}
+
+void bt_acquire(struct binder_state *bs, uint32_t handle)
+{
+	uint32_t cmd[2];
+
+	cmd[0] = BC_ACQUIRE;
+	cmd[1] = handle;
+	bt_write(bs, cmd, sizeof(cmd));
+}
+
+static void bt_serve(struct binder_state *bs,
+		     struct binder_transaction_data *txn, bt_handler handler)
+{
+	struct bt_parcel reply;
+	struct {
+		uint32_t cmd_free;
+		const void *buffer;
+		uint32_t cmd_reply;
+		struct binder_transaction_data txn;
+	} __attribute__((packed)) data;
+
+	bt_init(&reply);
+	handler(bs, txn, &reply);
+	if (txn->flags & TF_ONE_WAY) {
+		bt_free_buffer(bs, txn->data.ptr.buffer);
+		return;
+	}
+
+	data.cmd_free = BC_FREE_BUFFER;
+	data.buffer = txn->data.ptr.buffer;
+	data.cmd_reply = BC_REPLY;
+	memset(&data.txn, 0, sizeof(data.txn));
+	data.txn.data_size = reply.len;
+	data.txn.offsets_size = reply.nr_offs * sizeof(size_t);
+	data.txn.data.ptr.buffer = reply.data;
+	data.txn.data.ptr.offsets = reply.offs;
+	bt_write(bs, &data, sizeof(data));
+}
+
+/*
+ * Works through the return commands in [ptr, end).  Returns 1 once a
+ * reply has been stored in @reply, -1 on a failed call and 0 if more
+ * has to be read.
+ */
+static int bt_parse(struct binder_state *bs, uint8_t *ptr, uint8_t *end,
+		    struct binder_transaction_data *reply, bt_handler handler)
+{
+	struct binder_transaction_data txn;
+	struct binder_ptr_cookie pc;
+	uint32_t cmd;
+
+	while (ptr < end) {
+		memcpy(&cmd, ptr, sizeof(cmd));
+		ptr += sizeof(cmd);
+		switch (cmd) {
+		case BR_NOOP:
+		case BR_OK:
+		case BR_TRANSACTION_COMPLETE:
+		case BR_SPAWN_LOOPER:
+			break;
+		case BR_INCREFS:
+		case BR_ACQUIRE: {
+			struct {
+				uint32_t cmd;
+				struct binder_ptr_cookie pc;
+			} __attribute__((packed)) done;
+
+			memcpy(&pc, ptr, sizeof(pc));
+			ptr += sizeof(pc);
+			done.cmd = cmd == BR_INCREFS ?
+				BC_INCREFS_DONE : BC_ACQUIRE_DONE;
+			done.pc = pc;
+			bt_write(bs, &done, sizeof(done));
+			break;
+		}
+		case BR_RELEASE:
+		case BR_DECREFS:
+			ptr += sizeof(pc);
+			break;
+		case BR_DEAD_BINDER:
+		case BR_CLEAR_DEATH_NOTIFICATION_DONE:
+			ptr += sizeof(void *);
+			break;
+		case BR_TRANSACTION:
+			memcpy(&txn, ptr, sizeof(txn));
+			ptr += sizeof(txn);
+			if (!handler) {
+				fprintf(stderr, "binder: unexpected "
+					"transaction\n");
+				bt_free_buffer(bs, txn.data.ptr.buffer);
+				return -1;
+			}
+			bt_serve(bs, &txn, handler);
+			break;
+		case BR_REPLY:
+			memcpy(&txn, ptr, sizeof(txn));
+			ptr += sizeof(txn);
+			if (reply)
+				*reply = txn;
+			else
+				bt_free_buffer(bs, txn.data.ptr.buffer);
+			return 1;
+		case BR_DEAD_REPLY:
+			fprintf(stderr, "binder: dead reply\n");
+			return -1;
+		case BR_FAILED_REPLY:
+			fprintf(stderr, "binder: failed reply\n");
+			return -1;
+		case BR_ERROR:
+			fprintf(stderr, "binder: error\n");
+			return -1;
+		default:
+			fprintf(stderr, "binder: unknown return %x\n", cmd);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int bt_call(struct binder_state *bs, uint32_t handle, uint32_t code,
+	    const void *data, size_t len, const size_t *offs, size_t nr_offs,
+	    struct binder_transaction_data *reply)
+{
+	struct binder_write_read bwr;
+	struct {
+		uint32_t cmd;
+		struct binder_transaction_data txn;
+	} __attribute__((packed)) writebuf;
+	uint32_t readbuf[32];
+	int res;
+
+	writebuf.cmd = BC_TRANSACTION;
+	memset(&writebuf.txn, 0, sizeof(writebuf.txn));
+	writebuf.txn.target.handle = handle;
+	writebuf.txn.code = code;
+	writebuf.txn.flags = TF_ACCEPT_FDS;
+	writebuf.txn.data_size = len;
+	writebuf.txn.offsets_size = nr_offs * sizeof(size_t);
+	writebuf.txn.data.ptr.buffer = data;
+	writebuf.txn.data.ptr.offsets = offs;
+
+	memset(&bwr, 0, sizeof(bwr));
+	bwr.write_size = sizeof(writebuf);
+	bwr.write_buffer = (unsigned long)&writebuf;
+	for (;;) {
+		bwr.read_size = sizeof(readbuf);
+		bwr.read_consumed = 0;
+		bwr.read_buffer = (unsigned long)readbuf;
+		if (ioctl(bs->fd, BINDER_WRITE_READ, &bwr) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("binder call");
+			return -1;
+		}
+		res = bt_parse(bs, (uint8_t *)readbuf,
+			       (uint8_t *)readbuf + bwr.read_consumed,
+			       reply, NULL);
+		if (res)
+			return res > 0 ? 0 : -1;
+	}
+}
+
+void bt_loop(struct binder_state *bs, bt_handler handler)
+{
+	struct binder_write_read bwr;
+	uint32_t readbuf[32];
+	uint32_t cmd = BC_ENTER_LOOPER;
+
+	if (bt_write(bs, &cmd, sizeof(cmd)))
+		exit(1);
+	for (;;) {
+		memset(&bwr, 0, sizeof(bwr));
+		bwr.read_size = sizeof(readbuf);
+		bwr.read_buffer = (unsigned long)readbuf;
+		if (ioctl(bs->fd, BINDER_WRITE_READ, &bwr) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("binder loop");
+			exit(1);
+		}
+		if (bt_parse(bs, (uint8_t *)readbuf,
+			     (uint8_t *)readbuf + bwr.read_consumed,
+			     NULL, handler) < 0)
+			exit(1);
+	}
+}
+
+int bt_add_service(struct binder_state *bs, const char *name, void *ptr)
+{
+	struct binder_transaction_data reply;
+	struct bt_parcel msg;
+	uint32_t status = 1;
+
+	bt_init(&msg);
+	bt_put_u32(&msg, 0);	/* strict mode policy */
+	bt_put_string16(&msg, svcmgr_id);
+	bt_put_string16(&msg, name);
+	bt_put_binder(&msg, ptr);
+
+	if (bt_call(bs, SVC_MGR_HANDLE, SVC_MGR_ADD_SERVICE, msg.data,
+		    msg.len, msg.offs, msg.nr_offs, &reply))
+		return -1;
+	if (!(reply.flags & TF_STATUS_CODE) && reply.data_size >= sizeof(status))
+		memcpy(&status, reply.data.ptr.buffer, sizeof(status));
+	bt_free_buffer(bs, reply.data.ptr.buffer);
+	return status ? -1 : 0;
+}
+
+int bt_get_service(struct binder_state *bs, const char *name,
+		   uint32_t *handle)
+{
+	struct binder_transaction_data reply;
+	struct flat_binder_object obj;
+	struct bt_parcel msg;
+	int ret = -1;
+
+	bt_init(&msg);
+	bt_put_u32(&msg, 0);
+	bt_put_string16(&msg, svcmgr_id);
+	bt_put_string16(&msg, name);
+
+	if (bt_call(bs, SVC_MGR_HANDLE, SVC_MGR_CHECK_SERVICE, msg.data,
+		    msg.len, msg.offs, msg.nr_offs, &reply))
+		return -1;
+	if (!(reply.flags & TF_STATUS_CODE) && reply.data_size >= sizeof(obj)) {
+		memcpy(&obj, reply.data.ptr.buffer, sizeof(obj));
+		if (obj.type == BINDER_TYPE_HANDLE) {
+			*handle = obj.handle;
+			/* the reference in the reply goes with its buffer */
+			bt_acquire(bs, *handle);
+			ret = 0;
+		}
+	}
+	bt_free_buffer(bs, reply.data.ptr.buffer);
+	return ret;
+}
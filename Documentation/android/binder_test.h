@@ -0,0 +1,62 @@
+/*
+ * Minimal binder client/server helpers for the binder test programs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _BINDER_TEST_H
+#define _BINDER_TEST_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "binder.h"
+
+struct binder_state {
+	int fd;
+	void *mapped;
+	size_t mapsize;
+};
+
+/* A flat parcel: data plus the offsets of the objects in it */
+struct bt_parcel {
+	uint8_t data[512];
+	size_t len;
+	size_t offs[4];
+	size_t nr_offs;
+};
+
+/* Called for every incoming transaction, fills in the reply */
+typedef void (*bt_handler)(struct binder_state *bs,
+			   struct binder_transaction_data *txn,
+			   struct bt_parcel *reply);
+
+struct binder_state *bt_open(size_t mapsize);
+void bt_close(struct binder_state *bs);
+
+void bt_init(struct bt_parcel *p);
+void bt_put_u32(struct bt_parcel *p, uint32_t v);
+void bt_put_string16(struct bt_parcel *p, const char *s);
+void bt_put_binder(struct bt_parcel *p, void *ptr);
+
+/*
+ * Synchronous call on @handle.  The reply buffer is handed back in
+ * @reply and must be returned with bt_free_buffer().  Returns 0 or -1.
+ */
+int bt_call(struct binder_state *bs, uint32_t handle, uint32_t code,
+	    const void *data, size_t len, const size_t *offs, size_t nr_offs,
+	    struct binder_transaction_data *reply);
+void bt_free_buffer(struct binder_state *bs, const void *buffer);
+void bt_acquire(struct binder_state *bs, uint32_t handle);
+
+/* servicemanager */
+int bt_add_service(struct binder_state *bs, const char *name, void *ptr);
+int bt_get_service(struct binder_state *bs, const char *name,
+		   uint32_t *handle);
+
+/* Serves transactions on the calling thread, never returns */
+void bt_loop(struct binder_state *bs, bt_handler handler);
+
+#endif
@@ -0,0 +1,315 @@
+/*
+ * lmk_test - low memory killer victim order and cost with many processes
+ *
+ * Forks a few hundred children, spreads them over a range of oom_adj
+ * values and gives each a different amount of touched memory, then moves
+ * some of them to another oom_adj the way the activity manager would.
+ * The killer is then made to act by setting its single threshold above
+ * what is free, and every "echo 2 > drop_caches" runs the shrinkers once.
+ *
+ * The killer has one death outstanding at a time and only moves on once
+ * the victim has been reaped, so the children die in the order they were
+ * picked.  Each one must be the process with the highest oom_adj left,
+ * and the largest of those.  The time each shrinker pass takes is
+ * reported as well, run it with different numbers of children to see how
+ * it scales.
+ *
+ * Needs root.  The killer's adj and minfree parameters are restored on
+ * exit, but while it runs other processes at or above the lowest test
+ * oom_adj may be killed too, so use an otherwise idle test device.
+ *
+ * usage: lmk_test [-n children] [-a lowest adj] [-k kills] [-m KB step]
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define LMK_PARAM	"/sys/module/lowmemorykiller/parameters/"
+#define DROP_CACHES	"/proc/sys/vm/drop_caches"
+#define OOM_ADJUST_MAX	15
+#define MAX_CHILDREN	2000
+
+struct child {
+	pid_t pid;
+	int adj;
+	size_t size;
+	int alive;
+};
+
+static struct child children[MAX_CHILDREN];
+static int nr_children = 300;
+static char saved_adj[256], saved_minfree[256];
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int read_file(const char *path, char *buf, size_t len)
+{
+	int fd = open(path, O_RDONLY);
+	ssize_t n;
+
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	n = read(fd, buf, len - 1);
+	close(fd);
+	if (n < 0) {
+		perror(path);
+		return -1;
+	}
+	buf[n] = 0;
+	return 0;
+}
+
+static int write_file(const char *path, const char *val)
+{
+	int fd = open(path, O_WRONLY);
+	ssize_t n;
+
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	n = write(fd, val, strlen(val));
+	close(fd);
+	if (n != (ssize_t)strlen(val)) {
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static int set_adj(struct child *c, int adj)
+{
+	char path[64], val[16];
+
+	snprintf(path, sizeof(path), "/proc/%d/oom_adj", c->pid);
+	snprintf(val, sizeof(val), "%d", adj);
+	if (write_file(path, val))
+		return -1;
+	c->adj = adj;
+	return 0;
+}
+
+static void run_child(int fd, size_t size)
+{
+	char *mem = malloc(size);
+	char c = 0;
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	if (!mem)
+		exit(1);
+	memset(mem, 0x5a, size);
+	/* tell the parent our memory is in place, then wait to be killed */
+	if (write(fd, &c, 1) != 1)
+		exit(1);
+	for (;;)
+		pause();
+}
+
+static void restore_params(void)
+{
+	if (saved_adj[0])
+		write_file(LMK_PARAM "adj", saved_adj);
+	if (saved_minfree[0])
+		write_file(LMK_PARAM "minfree", saved_minfree);
+}
+
+static void cleanup(int sig)
+{
+	int i;
+
+	restore_params();
+	for (i = 0; i < nr_children; i++)
+		if (children[i].pid > 0)
+			kill(children[i].pid, SIGKILL);
+	_exit(1);
+}
+
+/* Was 'c' the child the killer should have picked among those alive? */
+static int right_victim(struct child *c)
+{
+	int i;
+
+	for (i = 0; i < nr_children; i++) {
+		struct child *o = &children[i];
+
+		if (!o->alive || o == c)
+			continue;
+		if (o->adj > c->adj || (o->adj == c->adj && o->size > c->size))
+			return 0;
+	}
+	return 1;
+}
+
+static struct child *find_child(pid_t pid)
+{
+	int i;
+
+	for (i = 0; i < nr_children; i++)
+		if (children[i].pid == pid)
+			return &children[i];
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	int min_adj = 8, kills = -1, moved = 0, killed = 0, wrong = 0;
+	int passes = 0, idle = 0, nr_adjs, ready[2], i, opt;
+	size_t step = 16 * 1024;
+	double t, total = 0, max = 0;
+	char buf[64];
+	struct child *c;
+	pid_t pid;
+
+	while ((opt = getopt(argc, argv, "n:a:k:m:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_children = atoi(optarg);
+			break;
+		case 'a':
+			min_adj = atoi(optarg);
+			break;
+		case 'k':
+			kills = atoi(optarg);
+			break;
+		case 'm':
+			step = strtoul(optarg, NULL, 0) * 1024;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n children] [-a lowest adj] "
+				"[-k kills] [-m KB step]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nr_children < 2 || nr_children > MAX_CHILDREN ||
+	    min_adj < 0 || min_adj >= OOM_ADJUST_MAX || !step) {
+		fprintf(stderr, "children must be 2..%d, lowest adj 0..%d\n",
+			MAX_CHILDREN, OOM_ADJUST_MAX - 1);
+		return 1;
+	}
+	if (kills < 0 || kills > nr_children)
+		kills = nr_children / 2;
+
+	if (read_file(LMK_PARAM "adj", saved_adj, sizeof(saved_adj)) ||
+	    read_file(LMK_PARAM "minfree", saved_minfree,
+		      sizeof(saved_minfree)))
+		return 1;
+	if (pipe(ready)) {
+		perror("pipe");
+		return 1;
+	}
+	signal(SIGINT, cleanup);
+	signal(SIGTERM, cleanup);
+
+	/*
+	 * Child i goes to adj min_adj + i % nr_adjs, and the children of one
+	 * adj get step, 2 * step, ... bytes.  The shuffle below can make two
+	 * of them the same size, then either one is a right victim.
+	 */
+	nr_adjs = OOM_ADJUST_MAX - min_adj + 1;
+	for (i = 0; i < nr_children; i++) {
+		c = &children[i];
+		c->size = (i / nr_adjs + 1) * step;
+		c->pid = fork();
+		if (c->pid == 0) {
+			close(ready[0]);
+			run_child(ready[1], c->size);
+		}
+		if (c->pid < 0) {
+			perror("fork");
+			cleanup(0);
+		}
+		c->alive = 1;
+		if (set_adj(c, min_adj + i % nr_adjs))
+			cleanup(0);
+	}
+	close(ready[1]);
+	for (i = 0; i < nr_children; i++)
+		if (read(ready[0], buf, 1) != 1) {
+			fprintf(stderr, "a child failed to start\n");
+			cleanup(0);
+		}
+
+	/* shuffle every fourth child to another bucket */
+	for (i = 0; i < nr_children; i += 4) {
+		c = &children[i];
+		if (set_adj(c, min_adj + (c->adj - min_adj + 3) % nr_adjs))
+			cleanup(0);
+		moved++;
+	}
+
+	snprintf(buf, sizeof(buf), "%d", min_adj);
+	if (write_file(LMK_PARAM "adj", buf) ||
+	    write_file(LMK_PARAM "minfree", "1073741824"))
+		cleanup(0);
+
+	while (killed < kills && idle < 20) {
+		t = now();
+		if (write_file(DROP_CACHES, "2"))
+			break;
+		t = now() - t;
+		total += t;
+		if (t > max)
+			max = t;
+		passes++;
+
+		/* the next kill waits until this victim has been reaped */
+		for (i = 0; i < 100; i++) {
+			pid = waitpid(-1, NULL, WNOHANG);
+			if (pid > 0)
+				break;
+			usleep(1000);
+		}
+		if (pid <= 0) {
+			idle++;
+			continue;
+		}
+		idle = 0;
+		c = find_child(pid);
+		if (!c)
+			continue;
+		if (!right_victim(c)) {
+			printf("pid %d adj %d size %zu KB killed out of order\n",
+			       c->pid, c->adj, c->size / 1024);
+			wrong++;
+		}
+		c->alive = 0;
+		c->pid = 0;
+		killed++;
+	}
+	restore_params();
+
+	printf("%d children at adj %d..%d, %d moved, %zu KB step\n",
+	       nr_children, min_adj, OOM_ADJUST_MAX, moved, step / 1024);
+	printf("killed %d of %d wanted, %d out of order\n", killed, kills,
+	       wrong);
+	if (passes)
+		printf("shrinker pass: avg %.0f us, max %.0f us over %d "
+		       "passes\n", total / passes * 1e6, max * 1e6, passes);
+
+	for (i = 0; i < nr_children; i++)
+		if (children[i].pid > 0)
+			kill(children[i].pid, SIGKILL);
+	while (wait(NULL) > 0 || errno == EINTR)
+		;
+	return killed == kills && !wrong ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/*
+ * logger_bench - log write throughput from many threads
+ *
+ * Starts a number of threads that all log to the same device through one
+ * shared descriptor, the way liblog does, for a fixed time and reports how
+ * many entries per second got written in total.  With -c it runs every
+ * thread count twice, once with concurrent writers and once with the
+ * logger's serialize_writes parameter set, which makes writers take the
+ * log's mutex as they used to, so both paths can be compared on one kernel.
+ *
+ * -c needs root to flip /sys/module/logger/parameters/serialize_writes.
+ *
+ * usage: logger_bench [-d device] [-t threads] [-s seconds] [-l msg bytes]
+ *		       [-c]
+ *   -t may be given several times, e.g. -t 1 -t 4 -t 16.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "logger.h"
+
+#define SERIALIZE_PARAM	"/sys/module/logger/parameters/serialize_writes"
+#define MAX_THREADS	256
+#define MAX_RUNS	16
+
+static int log_fd;
+static double run_secs = 5;
+static size_t msg_len = 64;
+static volatile int go, stop;
+
+struct worker {
+	pthread_t thread;
+	unsigned long writes;
+	unsigned long failed;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *writer(void *arg)
+{
+	struct worker *w = arg;
+	unsigned char prio = 4;		/* ANDROID_LOG_INFO */
+	char tag[] = "logger_bench";
+	struct iovec vec[3];
+	char *msg;
+
+	msg = malloc(msg_len + 1);
+	if (!msg)
+		return NULL;
+	memset(msg, 'x', msg_len);
+	msg[msg_len] = 0;
+
+	vec[0].iov_base = &prio;
+	vec[0].iov_len = 1;
+	vec[1].iov_base = tag;
+	vec[1].iov_len = sizeof(tag);
+	vec[2].iov_base = msg;
+	vec[2].iov_len = msg_len + 1;
+
+	while (!go)
+		;
+	while (!stop) {
+		if (writev(log_fd, vec, 3) < 0)
+			w->failed++;
+		else
+			w->writes++;
+	}
+	free(msg);
+	return NULL;
+}
+
+static int set_serialize(int on)
+{
+	int fd = open(SERIALIZE_PARAM, O_WRONLY);
+
+	if (fd < 0 || write(fd, on ? "Y" : "N", 1) != 1) {
+		perror(SERIALIZE_PARAM);
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+static double run(int threads, unsigned long *failed)
+{
+	static struct worker workers[MAX_THREADS];
+	unsigned long writes = 0;
+	double start, secs;
+	int i;
+
+	memset(workers, 0, sizeof(workers));
+	go = stop = 0;
+	for (i = 0; i < threads; i++)
+		if (pthread_create(&workers[i].thread, NULL, writer,
+				   &workers[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+
+	start = now();
+	go = 1;
+	usleep(run_secs * 1e6);
+	stop = 1;
+	secs = now() - start;
+
+	*failed = 0;
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		writes += workers[i].writes;
+		*failed += workers[i].failed;
+	}
+	return writes / secs;
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = "/dev/" LOGGER_LOG_MAIN;
+	int threads[MAX_RUNS], runs = 0, compare = 0, i, opt;
+	unsigned long failed;
+	double rate, serial;
+
+	while ((opt = getopt(argc, argv, "d:t:s:l:c")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev = optarg;
+			break;
+		case 't':
+			if (runs == MAX_RUNS) {
+				fprintf(stderr, "at most %d -t\n", MAX_RUNS);
+				return 1;
+			}
+			threads[runs++] = atoi(optarg);
+			break;
+		case 's':
+			run_secs = atof(optarg);
+			break;
+		case 'l':
+			msg_len = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			compare = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d device] [-t threads] "
+				"[-s seconds] [-l msg bytes] [-c]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!runs) {
+		threads[0] = 1;
+		threads[1] = 4;
+		threads[2] = 16;
+		runs = 3;
+	}
+	for (i = 0; i < runs; i++)
+		if (threads[i] < 1 || threads[i] > MAX_THREADS) {
+			fprintf(stderr, "threads must be 1..%d\n", MAX_THREADS);
+			return 1;
+		}
+	if (run_secs <= 0 || msg_len > LOGGER_ENTRY_MAX_PAYLOAD - 16) {
+		fprintf(stderr, "seconds must be > 0, msg at most %d bytes\n",
+			(int)LOGGER_ENTRY_MAX_PAYLOAD - 16);
+		return 1;
+	}
+
+	log_fd = open(dev, O_WRONLY);
+	if (log_fd < 0) {
+		perror(dev);
+		return 1;
+	}
+
+	printf("%s, %zu byte messages, %.1f s per run\n", dev, msg_len,
+	       run_secs);
+	if (compare && set_serialize(0))
+		return 1;
+	for (i = 0; i < runs; i++) {
+		rate = run(threads[i], &failed);
+		printf("%3d threads: %10.0f writes/s", threads[i], rate);
+		if (failed)
+			printf(" (%lu failed)", failed);
+		if (compare) {
+			if (set_serialize(1))
+				return 1;
+			serial = run(threads[i], &failed);
+			set_serialize(0);
+			printf(", serialized %10.0f writes/s (x%.2f)", serial,
+			       serial ? rate / serial : 0);
+			if (failed)
+				printf(" (%lu failed)", failed);
+		}
+		printf("\n");
+	}
+
+	close(log_fd);
+	return 0;
+}
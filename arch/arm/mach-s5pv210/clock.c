@@ -437,6 +437,21 @@ static u32 s5p_cpu_clk_tab_size(void)
 	return ARRAY_SIZE(clk_info);
 }
 
+/* HCLK_MSYS at the given DVFS level, in kHz */
+unsigned int s5pc11x_hclk_msys_rate(unsigned int index)
+{
+	u32 div;
+
+	if (index >= s5p_cpu_clk_tab_size())
+		return 0;
+
+	div = clk_info[index].msys_div0;
+	return clk_info[index].apllout / 1000 /
+		(((div & S5P_CLKDIV0_APLL_MASK) >> S5P_CLKDIV0_APLL_SHIFT) + 1) /
+		(((div & S5P_CLKDIV0_HCLK200_MASK) >>
+		  S5P_CLKDIV0_HCLK200_SHIFT) + 1);
+}
+
 static int s5pc11x_clk_set_withapllchange(unsigned int target_freq,
                                 unsigned int index )
 {
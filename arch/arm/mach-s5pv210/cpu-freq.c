@@ -19,6 +19,7 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/pm_qos_params.h>
 
 #include <asm/system.h>
 
@@ -68,11 +69,23 @@ static DECLARE_DELAYED_WORK(dvfs_info_print_work, inform_dvfs_clock_status);
 #endif
 #if ENABLE_DVFS_LOCK_HIGH
 unsigned int g_dvfs_high_lock_token = 0;
-static DEFINE_MUTEX(dvfs_high_lock);
-unsigned int g_dvfs_high_lock_limit = 4;
-unsigned int g_dvfslockval[NUMBER_OF_LOCKTOKEN];
 bool g_dvfs_fix_lock_limit = false; // global variable to avoid up frequency scaling 
 
+/*
+ * The lock tokens are PM_QOS_CPU_FREQ_MIN requirements, named after their
+ * users so they show up in debugfs/pm_qos.
+ */
+static char *dvfs_lock_names[NUMBER_OF_LOCKTOKEN] = {
+	[DVFS_LOCK_TOKEN_1] = "dvfs_lock_mfc",
+	[DVFS_LOCK_TOKEN_2] = "dvfs_lock_fimc",
+	[DVFS_LOCK_TOKEN_3] = "dvfs_lock_3",
+	[DVFS_LOCK_TOKEN_4] = "dvfs_lock_tvout_touch",
+	[DVFS_LOCK_TOKEN_5] = "dvfs_lock_earlysuspend",
+	[DVFS_LOCK_TOKEN_6] = "dvfs_lock_user",
+	[DVFS_LOCK_TOKEN_7] = "dvfs_lock_suspend",
+	[DVFS_LOCK_TOKEN_8] = "dvfs_lock_8",
+	[DVFS_LOCK_TOKEN_9] = "dvfs_lock_9",
+};
 #endif //ENABLE_DVFS_LOCK_HIGH
 
 extern int store_up_down_threshold(unsigned int down_threshold_value,
@@ -231,50 +244,55 @@ void set_dvfs_target_level(enum freq_level_states freq_level)
 void s5pc110_lock_dvfs_high_level(unsigned int nToken, enum freq_level_states freq_level) 
 {
 	unsigned int nLevel, ret, perf_level=0;
-	//printk("dvfs lock with token %d\n",nToken);
+	struct cpufreq_frequency_table *freq_tab = s5pc110_freq_table[S5PC11X_FREQ_TAB];
+
 	ret = get_dvfs_perf_level(freq_level, &perf_level);
 	if(ret)
 		return;
 	nLevel = perf_level;	
-	if (nToken == DVFS_LOCK_TOKEN_6 ) nLevel--; // token for launcher , this can use 1GHz
+	if (nToken == DVFS_LOCK_TOKEN_6 && nLevel > 0) nLevel--; // token for launcher , this can use 1GHz
 	// check lock corruption
 	if (g_dvfs_high_lock_token & (1 << nToken) ) printk ("\n\n[DVFSLOCK] lock token %d is already used!\n\n", nToken);
-	//mutex_lock(&dvfs_high_lock);
 	g_dvfs_high_lock_token |= (1 << nToken);
-	g_dvfslockval[nToken] = nLevel;
-	if (nLevel <  g_dvfs_high_lock_limit)
-		g_dvfs_high_lock_limit = nLevel;
-	//mutex_unlock(&dvfs_high_lock);
+	pm_qos_update_requirement(PM_QOS_CPU_FREQ_MIN, dvfs_lock_names[nToken],
+				  freq_tab[nLevel].frequency);
 	set_dvfs_perf_level(nLevel);
 }
 EXPORT_SYMBOL(s5pc110_lock_dvfs_high_level);
 
 void s5pc110_unlock_dvfs_high_level(unsigned int nToken) 
 {
-	unsigned int i;
-	//printk("dvfs unlock with token %d\n",nToken);
-	//mutex_lock(&dvfs_high_lock);
 	g_dvfs_high_lock_token &= ~(1 << nToken);
-	g_dvfslockval[nToken] = MAXFREQ_LEVEL_SUPPORTED-1;
-	g_dvfs_high_lock_limit = MAXFREQ_LEVEL_SUPPORTED-1;
-
-	if (g_dvfs_high_lock_token) {
-		for (i=0;i<NUMBER_OF_LOCKTOKEN;i++) {
-			if (g_dvfslockval[i] < g_dvfs_high_lock_limit)  g_dvfs_high_lock_limit = g_dvfslockval[i];
-		}
-	}
-
-	//mutex_unlock(&dvfs_high_lock);
+	pm_qos_update_requirement(PM_QOS_CPU_FREQ_MIN, dvfs_lock_names[nToken],
+				  PM_QOS_DEFAULT_VALUE);
 }
 EXPORT_SYMBOL(s5pc110_unlock_dvfs_high_level);
 #endif //ENABLE_DVFS_LOCK_HIGH
 
+/*
+ * The slowest level that meets the PM_QOS_CPU_FREQ_MIN and
+ * PM_QOS_BUS_FREQ_MIN floors; the last level when there are none.
+ */
+static unsigned int s5pc110_qos_floor_index(void)
+{
+	struct cpufreq_frequency_table *freq_tab = s5pc110_freq_table[S5PC11X_FREQ_TAB];
+	s32 cpu_min = pm_qos_requirement(PM_QOS_CPU_FREQ_MIN);
+	s32 bus_min = pm_qos_requirement(PM_QOS_BUS_FREQ_MIN);
+	unsigned int index = MAXFREQ_LEVEL_SUPPORTED - 1;
+
+	while (index > 0 && (freq_tab[index].frequency < cpu_min ||
+			     s5pc11x_hclk_msys_rate(index) < bus_min))
+		index--;
+
+	return index;
+}
+
 unsigned int s5pc11x_target_frq(unsigned int pred_freq, 
 				int flag)
 {
 	int index;
 	unsigned long irqflags;
-	unsigned int freq;
+	unsigned int freq, floor;
 
 	struct cpufreq_frequency_table *freq_tab = s5pc110_freq_table[S5PC11X_FREQ_TAB];
 	
@@ -299,13 +317,14 @@ unsigned int s5pc11x_target_frq(unsigned int pred_freq,
 		index = 0; 
 	}*/
 
-	if (g_dvfs_high_lock_token) {
+	floor = s5pc110_qos_floor_index();
+	if (floor < MAXFREQ_LEVEL_SUPPORTED - 1) {
 		 if(g_dvfs_fix_lock_limit == true) {
-			 index = g_dvfs_high_lock_limit;// use the same level
+			 index = floor;// use the same level
 		 }
 		 else {
-			if (index > g_dvfs_high_lock_limit)
-				index = g_dvfs_high_lock_limit;
+			if (index > floor)
+				index = floor;
 		 }
 	}
 	//printk("s5pc11x_target_frq index = %d\n",index);
@@ -334,7 +353,8 @@ int s5pc11x_target_freq_index(unsigned int freq)
 
 	/*Index might have been calculated before calling this function.
 	check and early return if it is already calculated*/
-	if(freq_tab[s5pc11x_cpufreq_index].frequency == freq) {		
+	if(freq_tab[s5pc11x_cpufreq_index].frequency == freq &&
+	   s5pc11x_cpufreq_index <= s5pc110_qos_floor_index()) {		
 		return s5pc11x_cpufreq_index;
 	}
 
@@ -354,6 +374,8 @@ int s5pc11x_target_freq_index(unsigned int freq)
 	}
 
 s5pc11x_target_freq_index_end:
+	/* whatever the governor asked for, honor the frequency floors */
+	index = CLIP_LEVEL(index, s5pc110_qos_floor_index());
 	spin_lock_irqsave(&g_dvfslock, irqflags);
 	index = CLIP_LEVEL(index, s5pc11x_cpufreq_level);
 	s5pc11x_cpufreq_index = index;
@@ -691,7 +713,6 @@ unsigned int get_min_cpufreq(void)
 
 static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 {
-	u32 i;
 	//unsigned long irqflags;
 
 	mpu_clk = clk_get(NULL, MPU_CLK);
@@ -709,12 +730,10 @@ static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 		S5PC11X_FREQ_TAB = 1;
 		S5PC11X_MAXFREQLEVEL = 5;
 		MAXFREQ_LEVEL_SUPPORTED = 6;
-		g_dvfs_high_lock_limit = 5;
 #else
 		S5PC11X_FREQ_TAB = 0;
 		S5PC11X_MAXFREQLEVEL = 4;
 		MAXFREQ_LEVEL_SUPPORTED = 5;
-		g_dvfs_high_lock_limit = 4;
 #endif
 	
 	printk("S5PC11X_FREQ_TAB=%d , S5PC11X_MAXFREQLEVEL=%d\n",S5PC11X_FREQ_TAB,S5PC11X_MAXFREQLEVEL);
@@ -739,12 +758,6 @@ static int __init s5pc110_cpu_init(struct cpufreq_policy *policy)
 //	register_early_suspend(&s5pc11x_freq_suspend);	
 #endif
 
-	#if ENABLE_DVFS_LOCK_HIGH
-	/*initialise the dvfs lock level table*/
-	for(i = 0; i < NUMBER_OF_LOCKTOKEN; i++)
-		g_dvfslockval[i] = MAXFREQ_LEVEL_SUPPORTED-1;
-	#endif
-
 
 	return cpufreq_frequency_table_cpuinfo(policy, s5pc110_freq_table[S5PC11X_FREQ_TAB]);
 }
@@ -760,6 +773,18 @@ static struct cpufreq_driver s5pc110_driver = {
 
 static int __init s5pc110_cpufreq_init(void)
 {
+#if ENABLE_DVFS_LOCK_HIGH
+	int i;
+
+	/* the lock calls may come from atomic context, so add them here */
+	for (i = 0; i < NUMBER_OF_LOCKTOKEN; i++) {
+		if (pm_qos_add_requirement(PM_QOS_CPU_FREQ_MIN,
+					   dvfs_lock_names[i],
+					   PM_QOS_DEFAULT_VALUE))
+			printk(KERN_ERR "%s: no dvfs lock %s\n", __func__,
+			       dvfs_lock_names[i]);
+	}
+#endif
 	return cpufreq_register_driver(&s5pc110_driver);
 }
 
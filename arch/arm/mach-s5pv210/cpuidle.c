@@ -31,7 +31,7 @@
 #include <plat/regs-otg.h>
 #include <mach/regs-gpio.h>
 
-#define S5PC110_MAX_STATES	1
+#define S5PC110_MAX_STATES	2
 
 static void s5p_enter_idle(void)
 {
@@ -463,12 +463,18 @@ static int s5p_enter_idle_lpaudio(struct cpuidle_device *dev,
 	return idle_time;
 }
 
+/*
+ * The governor only picks this state when it predicts a long enough idle;
+ * if a device is busy it is demoted to plain WFI, which the cpuidle core
+ * learns through dev->last_state.
+ */
 static int s5p_enter_idle_bm(struct cpuidle_device *dev,
 				struct cpuidle_state *state)
 {
-	if (s5p_idle_bm_check())
+	if (s5p_idle_bm_check()) {
+		dev->last_state = &dev->states[0];
 		return s5p_enter_idle_normal(dev, state);
-	else
+	} else
 		return s5p_enter_idle_lpaudio(dev, state);
 }
 
@@ -494,15 +500,25 @@ int s5p_setup_lpaudio(unsigned int mode)
 		strcpy(device->states[0].desc, "ARM clock gating - WFI");
 		break;
 	case LPAUDIO_MODE:
-		device->state_count = 1;
-		/* Wait for interrupt state */
-		device->states[0].enter = s5p_enter_idle_bm;
-		device->states[0].exit_latency = 300;	/* uS */
-		device->states[0].target_residency = 5000;
-		device->states[0].flags = CPUIDLE_FLAG_TIME_VALID |
+		device->state_count = 2;
+		/*
+		 * Wait for interrupt state, for idles the governor expects
+		 * to be too short for idle2
+		 */
+		device->states[0].enter = s5p_enter_idle_normal;
+		device->states[0].exit_latency = 1;	/* uS */
+		device->states[0].target_residency = 1;
+		device->states[0].flags = CPUIDLE_FLAG_TIME_VALID;
+		strcpy(device->states[0].name, "IDLE");
+		strcpy(device->states[0].desc, "ARM clock gating - WFI");
+
+		device->states[1].enter = s5p_enter_idle_bm;
+		device->states[1].exit_latency = 300;	/* uS */
+		device->states[1].target_residency = 5000;
+		device->states[1].flags = CPUIDLE_FLAG_TIME_VALID |
 						CPUIDLE_FLAG_CHECK_BM;
-		strcpy(device->states[0].name, "IDLE2");
-		strcpy(device->states[0].desc, "S5PC110 idle2");
+		strcpy(device->states[1].name, "IDLE2");
+		strcpy(device->states[1].desc, "S5PC110 idle2");
 
 		break;
 	default:
@@ -57,6 +57,7 @@ extern int set_voltage_dvs(enum perf_level p_lv);
 
 extern int s5pc110_dvfs_lock_high_hclk(unsigned int dToken);
 extern int s5pc110_dvfs_unlock_high_hclk(unsigned int dToken);
+extern unsigned int s5pc11x_hclk_msys_rate(unsigned int index);
 
 #define NUMBER_OF_LOCKTOKEN 9
 
@@ -21,6 +21,7 @@
 #include <linux/kallsyms.h>
 #include <linux/mutex.h>
 #include <linux/pm.h>
+#include <linux/pm_profile.h>
 #include <linux/pm_runtime.h>
 #include <linux/resume-trace.h>
 #include <linux/rwsem.h>
@@ -340,6 +341,7 @@ static void pm_dev_err(struct device *dev, pm_message_t state, char *info,
  */
 static int device_resume_noirq(struct device *dev, pm_message_t state)
 {
+	u64 start = pm_profile_start();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -353,6 +355,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 		error = pm_noirq_op(dev, dev->bus->pm, state);
 	}
  End:
+	pm_profile_dev(PM_PROFILE_RESUME_NOIRQ, dev, start, error);
 	TRACE_RESUME(error);
 	return error;
 }
@@ -391,6 +394,7 @@ EXPORT_SYMBOL_GPL(dpm_resume_noirq);
  */
 static int device_resume(struct device *dev, pm_message_t state)
 {
+	u64 start = pm_profile_start();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -431,6 +435,7 @@ static int device_resume(struct device *dev, pm_message_t state)
  End:
 	up(&dev->sem);
 
+	pm_profile_dev(PM_PROFILE_RESUME, dev, start, error);
 	TRACE_RESUME(error);
 	return error;
 }
@@ -625,6 +630,7 @@ static pm_message_t resume_event(pm_message_t sleep_state)
  */
 static int device_suspend_noirq(struct device *dev, pm_message_t state)
 {
+	u64 start = pm_profile_start();
 	int error = 0;
 
 	if (!dev->bus)
@@ -634,6 +640,7 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state)
 		pm_dev_dbg(dev, state, "LATE ");
 		error = pm_noirq_op(dev, dev->bus->pm, state);
 	}
+	pm_profile_dev(PM_PROFILE_SUSPEND_NOIRQ, dev, start, error);
 	return error;
 }
 
@@ -673,6 +680,7 @@ EXPORT_SYMBOL_GPL(dpm_suspend_noirq);
  */
 static int device_suspend(struct device *dev, pm_message_t state)
 {
+	u64 start = pm_profile_start();
 	int error = 0;
 
 	down(&dev->sem);
@@ -712,6 +720,7 @@ static int device_suspend(struct device *dev, pm_message_t state)
  End:
 	up(&dev->sem);
 
+	pm_profile_dev(PM_PROFILE_SUSPEND, dev, start, error);
 	return error;
 }
 
@@ -0,0 +1,196 @@
+/*
+ * drivers/base/power/profile.c - Suspend/resume latency profiling
+ *
+ * This file is released under the GPLv2
+ *
+ * Every device callback run by main.c, every sysdev callback run by
+ * drivers/base/sys.c and every stage of kernel/power/suspend.c is recorded
+ * with its duration in a ring buffer.  debugfs exposes the ring in order
+ * ("log") and the slowest records it holds ("slowest").
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/pm_profile.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#define PM_PROFILE_ENTRIES	1024
+#define PM_PROFILE_NAME_LEN	24
+
+struct pm_profile_entry {
+	unsigned int cycle;
+	enum pm_profile_phase phase;
+	int error;
+	u32 duration_us;
+	void *fn;
+	char name[PM_PROFILE_NAME_LEN];
+};
+
+static const char *const pm_profile_phase_names[] = {
+	[PM_PROFILE_STAGE]		= "stage",
+	[PM_PROFILE_SUSPEND]		= "suspend",
+	[PM_PROFILE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[PM_PROFILE_SYSDEV_SUSPEND]	= "sysdev_suspend",
+	[PM_PROFILE_SYSDEV_RESUME]	= "sysdev_resume",
+	[PM_PROFILE_RESUME_NOIRQ]	= "resume_noirq",
+	[PM_PROFILE_RESUME]		= "resume",
+};
+
+/* records may come from the sysdev phase, so the lock is irq-safe */
+static DEFINE_SPINLOCK(pm_profile_lock);
+static struct pm_profile_entry pm_profile_ring[PM_PROFILE_ENTRIES];
+static unsigned int pm_profile_head;	/* next slot to write */
+static unsigned int pm_profile_count;	/* valid slots */
+static unsigned int pm_profile_cycle;
+
+/* callbacks faster than this are not recorded, unless they failed */
+static u32 pm_profile_threshold_us = 1000;
+static u32 pm_profile_slowest_n = 20;
+
+/**
+ * pm_profile_begin - Start a new suspend cycle.
+ *
+ * Records made until the next call are tagged with the same cycle number.
+ */
+void pm_profile_begin(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	pm_profile_cycle++;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/**
+ * pm_profile_record - Record the duration of a callback or stage.
+ * @phase: What was run.
+ * @name: Device, sysdev or stage name; copied.
+ * @fn: Callback run, printed with %pF, or NULL.
+ * @start: Value of pm_profile_start() taken before running it.
+ * @error: What it returned.
+ */
+void pm_profile_record(enum pm_profile_phase phase, const char *name,
+		       void *fn, u64 start, int error)
+{
+	struct pm_profile_entry *e;
+	unsigned long flags;
+	u64 now = pm_profile_start();
+	u32 duration_us;
+
+	/* the clock may be stopped or reset around the sysdev phase */
+	duration_us = now > start ? div_u64(now - start, NSEC_PER_USEC) : 0;
+	if (duration_us < pm_profile_threshold_us && !error)
+		return;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	e = &pm_profile_ring[pm_profile_head];
+	e->cycle = pm_profile_cycle;
+	e->phase = phase;
+	e->error = error;
+	e->duration_us = duration_us;
+	e->fn = fn;
+	strlcpy(e->name, name, sizeof(e->name));
+	pm_profile_head = (pm_profile_head + 1) % PM_PROFILE_ENTRIES;
+	if (pm_profile_count < PM_PROFILE_ENTRIES)
+		pm_profile_count++;
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+}
+
+/* Copy the ring, oldest record first; returns the number of records. */
+static unsigned int pm_profile_snapshot(struct pm_profile_entry *buf)
+{
+	unsigned long flags;
+	unsigned int first, count, n;
+
+	spin_lock_irqsave(&pm_profile_lock, flags);
+	count = pm_profile_count;
+	first = (pm_profile_head + PM_PROFILE_ENTRIES - count) %
+		PM_PROFILE_ENTRIES;
+	n = min(count, PM_PROFILE_ENTRIES - first);
+	memcpy(buf, &pm_profile_ring[first], n * sizeof(*buf));
+	memcpy(buf + n, pm_profile_ring, (count - n) * sizeof(*buf));
+	spin_unlock_irqrestore(&pm_profile_lock, flags);
+
+	return count;
+}
+
+static void pm_profile_show_entry(struct seq_file *m,
+				  struct pm_profile_entry *e)
+{
+	seq_printf(m, "%5u %-14s %-24s %8u", e->cycle,
+		   pm_profile_phase_names[e->phase], e->name, e->duration_us);
+	if (e->error)
+		seq_printf(m, " error=%d", e->error);
+	if (e->fn)
+		seq_printf(m, " %pF", e->fn);
+	seq_putc(m, '\n');
+}
+
+static int pm_profile_cmp_duration(const void *a, const void *b)
+{
+	const struct pm_profile_entry *ea = a, *eb = b;
+
+	if (ea->duration_us == eb->duration_us)
+		return 0;
+	return ea->duration_us < eb->duration_us ? 1 : -1;
+}
+
+static int pm_profile_show(struct seq_file *m, void *unused)
+{
+	int slowest = (long)m->private;
+	struct pm_profile_entry *buf;
+	unsigned int i, count;
+
+	buf = vmalloc(sizeof(pm_profile_ring));
+	if (!buf)
+		return -ENOMEM;
+
+	count = pm_profile_snapshot(buf);
+	if (slowest) {
+		sort(buf, count, sizeof(*buf), pm_profile_cmp_duration, NULL);
+		count = min(count, pm_profile_slowest_n);
+	}
+
+	seq_printf(m, "cycle phase          name                      time_us\n");
+	for (i = 0; i < count; i++)
+		pm_profile_show_entry(m, &buf[i]);
+
+	vfree(buf);
+	return 0;
+}
+
+static int pm_profile_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_profile_show, inode->i_private);
+}
+
+static const struct file_operations pm_profile_fops = {
+	.open		= pm_profile_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pm_profile_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("suspend_profile", NULL);
+	if (!dir)
+		return -ENOMEM;
+	debugfs_create_file("log", S_IRUGO, dir, (void *)0L, &pm_profile_fops);
+	debugfs_create_file("slowest", S_IRUGO, dir, (void *)1L,
+			    &pm_profile_fops);
+	debugfs_create_u32("slowest_n", S_IRUGO | S_IWUSR, dir,
+			   &pm_profile_slowest_n);
+	debugfs_create_u32("threshold_us", S_IRUGO | S_IWUSR, dir,
+			   &pm_profile_threshold_us);
+	return 0;
+}
+late_initcall(pm_profile_init);
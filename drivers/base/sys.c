@@ -20,6 +20,7 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/pm.h>
+#include <linux/pm_profile.h>
 #include <linux/device.h>
 #include <linux/mutex.h>
 #include <linux/interrupt.h>
@@ -345,17 +346,28 @@ static void __sysdev_resume(struct sys_device *dev)
 {
 	struct sysdev_class *cls = dev->cls;
 	struct sysdev_driver *drv;
+	u64 start;
 
 	/* First, call the class-specific one */
-	if (cls->resume)
+	if (cls->resume) {
+		start = pm_profile_start();
 		cls->resume(dev);
+		pm_profile_record(PM_PROFILE_SYSDEV_RESUME,
+				  kobject_name(&dev->kobj), cls->resume,
+				  start, 0);
+	}
 	WARN_ONCE(!irqs_disabled(),
 		"Interrupts enabled after %pF\n", cls->resume);
 
 	/* Call auxillary drivers next. */
 	list_for_each_entry(drv, &cls->drivers, entry) {
-		if (drv->resume)
+		if (drv->resume) {
+			start = pm_profile_start();
 			drv->resume(dev);
+			pm_profile_record(PM_PROFILE_SYSDEV_RESUME,
+					  kobject_name(&dev->kobj),
+					  drv->resume, start, 0);
+		}
 		WARN_ONCE(!irqs_disabled(),
 			"Interrupts enabled after %pF\n", drv->resume);
 	}
@@ -378,6 +390,7 @@ int sysdev_suspend(pm_message_t state)
 	struct sysdev_class *cls;
 	struct sys_device *sysdev, *err_dev;
 	struct sysdev_driver *drv, *err_drv;
+	u64 start;
 	int ret;
 
 	pr_debug("Checking wake-up interrupts\n");
@@ -402,7 +415,12 @@ int sysdev_suspend(pm_message_t state)
 			/* Call auxillary drivers first */
 			list_for_each_entry(drv, &cls->drivers, entry) {
 				if (drv->suspend) {
+					start = pm_profile_start();
 					ret = drv->suspend(sysdev, state);
+					pm_profile_record(
+						PM_PROFILE_SYSDEV_SUSPEND,
+						kobject_name(&sysdev->kobj),
+						drv->suspend, start, ret);
 					if (ret)
 						goto aux_driver;
 				}
@@ -413,7 +431,11 @@ int sysdev_suspend(pm_message_t state)
 
 			/* Now call the generic one */
 			if (cls->suspend) {
+				start = pm_profile_start();
 				ret = cls->suspend(sysdev, state);
+				pm_profile_record(PM_PROFILE_SYSDEV_SUSPEND,
+						  kobject_name(&sysdev->kobj),
+						  cls->suspend, start, ret);
 				if (ret)
 					goto cls_driver;
 				WARN_ONCE(!irqs_disabled(),
@@ -0,0 +1,188 @@
+/*
+ * zpool - allocator for compressed pages
+ *
+ * This file is released under the GPLv2.
+ *
+ * Compressed pages come in every size up to PAGE_SIZE, and kmalloc would
+ * round most of them up to the next power of two.  zpool instead keeps
+ * size classes ZPOOL_ALIGN bytes apart.  Each class carves whole pages
+ * into objects of its size.  Classes that fit the same number of objects
+ * in a page are merged into the largest of them, since the smaller ones
+ * would only waste more of the page's tail.
+ *
+ * A page's bookkeeping lives in its struct page:
+ *	->lru		on its class's list of pages with free objects
+ *	->private	index of its class
+ *	->index		objects in use << 16 | first free object
+ * and each free object holds the index of the next free one.
+ *
+ * Pages are lowmem, so an object is just a kernel pointer.
+ */
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include "zpool.h"
+
+#define ZPOOL_ALIGN_SHIFT	5
+#define ZPOOL_ALIGN		(1 << ZPOOL_ALIGN_SHIFT)
+#define ZPOOL_NR_CLASSES	(PAGE_SIZE >> ZPOOL_ALIGN_SHIFT)
+#define ZPOOL_NO_FREE		0xffff
+
+struct zpool_class {
+	unsigned int size;
+	unsigned int objs_per_page;
+	struct list_head partial;	/* pages with free objects */
+};
+
+struct zpool {
+	spinlock_t lock;
+	unsigned long pages;
+	/* class to allocate an object of up to (i + 1) * ZPOOL_ALIGN from */
+	struct zpool_class *class_of[ZPOOL_NR_CLASSES];
+	struct zpool_class classes[ZPOOL_NR_CLASSES];
+};
+
+static inline unsigned int page_inuse(struct page *page)
+{
+	return page->index >> 16;
+}
+
+static inline unsigned int page_first_free(struct page *page)
+{
+	return page->index & 0xffff;
+}
+
+static inline void set_page_objs(struct page *page, unsigned int inuse,
+				 unsigned int first_free)
+{
+	page->index = inuse << 16 | first_free;
+}
+
+static inline u16 *obj_next(struct zpool_class *class, struct page *page,
+			    unsigned int i)
+{
+	return page_address(page) + i * class->size;
+}
+
+struct zpool *zpool_create(void)
+{
+	struct zpool *pool;
+	int i;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	spin_lock_init(&pool->lock);
+	for (i = ZPOOL_NR_CLASSES - 1; i >= 0; i--) {
+		struct zpool_class *class = &pool->classes[i];
+
+		class->size = (i + 1) * ZPOOL_ALIGN;
+		class->objs_per_page = PAGE_SIZE / class->size;
+		INIT_LIST_HEAD(&class->partial);
+
+		if (i < ZPOOL_NR_CLASSES - 1 && class->objs_per_page ==
+					pool->class_of[i + 1]->objs_per_page)
+			pool->class_of[i] = pool->class_of[i + 1];
+		else
+			pool->class_of[i] = class;
+	}
+
+	return pool;
+}
+
+/* Every object must have been freed. */
+void zpool_destroy(struct zpool *pool)
+{
+	WARN_ON(pool->pages);
+	kfree(pool);
+}
+
+/**
+ * zpool_alloc - allocate an object
+ * @pool: pool to allocate from
+ * @size: 1 to PAGE_SIZE bytes
+ * @flags: for the page allocator, should it need a new page
+ *
+ * Returns the object, or NULL.
+ */
+void *zpool_alloc(struct zpool *pool, size_t size, gfp_t flags)
+{
+	struct zpool_class *class;
+	struct page *page;
+	unsigned int i;
+	u16 *obj;
+
+	if (unlikely(!size || size > PAGE_SIZE))
+		return NULL;
+	class = pool->class_of[(size - 1) >> ZPOOL_ALIGN_SHIFT];
+
+	spin_lock(&pool->lock);
+	if (list_empty(&class->partial)) {
+		spin_unlock(&pool->lock);
+
+		page = alloc_page(flags & ~__GFP_HIGHMEM);
+		if (!page)
+			return NULL;
+		set_page_private(page, class - pool->classes);
+		set_page_objs(page, 0, 0);
+		for (i = 0; i < class->objs_per_page - 1; i++)
+			*obj_next(class, page, i) = i + 1;
+		*obj_next(class, page, i) = ZPOOL_NO_FREE;
+
+		spin_lock(&pool->lock);
+		list_add(&page->lru, &class->partial);
+		pool->pages++;
+	}
+
+	page = list_first_entry(&class->partial, struct page, lru);
+	i = page_first_free(page);
+	obj = obj_next(class, page, i);
+	set_page_objs(page, page_inuse(page) + 1, *obj);
+	if (*obj == ZPOOL_NO_FREE)
+		list_del_init(&page->lru);
+	spin_unlock(&pool->lock);
+
+	return obj;
+}
+
+/**
+ * zpool_free - free an object
+ * @pool: pool it came from
+ * @obj: the object
+ */
+void zpool_free(struct zpool *pool, void *obj)
+{
+	struct page *page = virt_to_page(obj);
+	struct zpool_class *class = &pool->classes[page_private(page)];
+	unsigned int i = (obj - page_address(page)) / class->size;
+	unsigned int inuse;
+
+	spin_lock(&pool->lock);
+	*(u16 *)obj = page_first_free(page);
+	if (page_first_free(page) == ZPOOL_NO_FREE)
+		list_add(&page->lru, &class->partial);
+	inuse = page_inuse(page) - 1;
+	set_page_objs(page, inuse, i);
+	if (!inuse) {
+		list_del(&page->lru);
+		pool->pages--;
+	}
+	spin_unlock(&pool->lock);
+
+	if (!inuse) {
+		set_page_private(page, 0);
+		page->index = 0;
+		__free_page(page);
+	}
+}
+
+/* Memory the pool takes from the system, in bytes. */
+u64 zpool_total_size(struct zpool *pool)
+{
+	return (u64)pool->pages << PAGE_SHIFT;
+}
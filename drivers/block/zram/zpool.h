@@ -0,0 +1,22 @@
+/*
+ * zpool - allocator for compressed pages
+ *
+ * This file is released under the GPLv2.
+ */
+
+#ifndef _ZPOOL_H_
+#define _ZPOOL_H_
+
+#include <linux/types.h>
+
+struct zpool;
+
+struct zpool *zpool_create(void);
+void zpool_destroy(struct zpool *pool);
+
+void *zpool_alloc(struct zpool *pool, size_t size, gfp_t flags);
+void zpool_free(struct zpool *pool, void *obj);
+
+u64 zpool_total_size(struct zpool *pool);
+
+#endif
@@ -0,0 +1,616 @@
+/*
+ * Compressed RAM block device
+ *
+ * This file is released under the GPLv2.
+ *
+ * Each /dev/zramN keeps the pages written to it LZO-compressed in memory,
+ * which makes it a swap device that costs no flash wear or seek time and
+ * holds two to three times its memory footprint of anonymous pages.
+ *
+ * Set the size through /sys/block/zramN/disksize, then mkswap and swapon
+ * it.  I/O must be in whole, aligned pages, which is what swap and
+ * filesystems with 4K blocks do.  Freed swap slots are dropped right away
+ * through swap_slot_free_notify, and discard requests are honoured for
+ * everything else.
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/bio.h>
+#include <linux/bitops.h>
+#include <linux/blkdev.h>
+#include <linux/buffer_head.h>
+#include <linux/device.h>
+#include <linux/genhd.h>
+#include <linux/highmem.h>
+#include <linux/lzo.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+
+static int zram_major;
+static struct zram *devices;
+
+static unsigned int num_devices = 1;
+module_param(num_devices, uint, 0);
+MODULE_PARM_DESC(num_devices, "Number of zram devices");
+
+static void zram_stat64_add(struct zram *zram, u64 *v, u64 inc)
+{
+	spin_lock(&zram->table_lock);
+	*v += inc;
+	spin_unlock(&zram->table_lock);
+}
+
+static void zram_stat64_inc(struct zram *zram, u64 *v)
+{
+	zram_stat64_add(zram, v, 1);
+}
+
+static u64 zram_stat64_read(struct zram *zram, u64 *v)
+{
+	u64 val;
+
+	spin_lock(&zram->table_lock);
+	val = *v;
+	spin_unlock(&zram->table_lock);
+
+	return val;
+}
+
+static int zram_test_flag(struct zram *zram, u32 index,
+			  enum zram_pageflags flag)
+{
+	return zram->table[index].flags & BIT(flag);
+}
+
+/* Called with table_lock held. */
+static void zram_free_page(struct zram *zram, u32 index)
+{
+	struct zram_table_entry *entry = &zram->table[index];
+
+	if (!entry->handle)
+		return;
+
+	if (zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))
+		zram->stats.pages_expand--;
+	zram->stats.compr_size -= entry->size;
+	zram->stats.pages_stored--;
+
+	zpool_free(zram->mem_pool, entry->handle);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static int zram_read(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_table_entry *entry = &zram->table[index];
+	size_t clen = PAGE_SIZE;
+	unsigned char *dst;
+	int ret = LZO_E_OK;
+
+	spin_lock(&zram->table_lock);
+	dst = kmap_atomic(page, KM_USER0);
+	if (!entry->handle)
+		/* never written, or discarded */
+		memset(dst, 0, PAGE_SIZE);
+	else if (zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))
+		memcpy(dst, entry->handle, PAGE_SIZE);
+	else
+		ret = lzo1x_decompress_safe(entry->handle, entry->size,
+					    dst, &clen);
+	kunmap_atomic(dst, KM_USER0);
+	spin_unlock(&zram->table_lock);
+
+	if (unlikely(ret != LZO_E_OK || clen != PAGE_SIZE)) {
+		pr_err("decompression of page %u failed: %d\n", index, ret);
+		zram_stat64_inc(zram, &zram->stats.failed_reads);
+		return -EIO;
+	}
+
+	flush_dcache_page(page);
+	return 0;
+}
+
+static int zram_write(struct zram *zram, struct page *page, u32 index)
+{
+	struct zram_table_entry *entry = &zram->table[index];
+	unsigned char *src;
+	size_t clen;
+	void *handle;
+	int ret;
+
+	mutex_lock(&zram->lock);
+
+	src = kmap_atomic(page, KM_USER0);
+	ret = lzo1x_1_compress(src, PAGE_SIZE, zram->compress_buffer, &clen,
+			       zram->compress_workmem);
+	kunmap_atomic(src, KM_USER0);
+	if (unlikely(ret != LZO_E_OK)) {
+		mutex_unlock(&zram->lock);
+		pr_err("compression of page %u failed: %d\n", index, ret);
+		zram_stat64_inc(zram, &zram->stats.failed_writes);
+		return -EIO;
+	}
+
+	if (unlikely(clen > ZRAM_MAX_ZPAGE_SIZE))
+		clen = PAGE_SIZE;
+
+	handle = zpool_alloc(zram->mem_pool, clen, GFP_NOIO);
+	if (unlikely(!handle)) {
+		mutex_unlock(&zram->lock);
+		zram_stat64_inc(zram, &zram->stats.failed_writes);
+		return -ENOMEM;
+	}
+
+	if (clen == PAGE_SIZE) {
+		src = kmap_atomic(page, KM_USER0);
+		memcpy(handle, src, PAGE_SIZE);
+		kunmap_atomic(src, KM_USER0);
+	} else {
+		memcpy(handle, zram->compress_buffer, clen);
+	}
+
+	mutex_unlock(&zram->lock);
+
+	spin_lock(&zram->table_lock);
+	zram_free_page(zram, index);
+	entry->handle = handle;
+	entry->size = clen;
+	if (clen == PAGE_SIZE) {
+		entry->flags |= BIT(ZRAM_UNCOMPRESSED);
+		zram->stats.pages_expand++;
+	}
+	zram->stats.compr_size += clen;
+	zram->stats.pages_stored++;
+	spin_unlock(&zram->table_lock);
+
+	return 0;
+}
+
+/* Drop the pages wholly inside a discarded range. */
+static void zram_discard(struct zram *zram, struct bio *bio)
+{
+	sector_t start = ALIGN(bio->bi_sector, SECTORS_PER_PAGE);
+	sector_t end = bio->bi_sector + (bio->bi_size >> SECTOR_SHIFT);
+	u32 index;
+
+	spin_lock(&zram->table_lock);
+	for (index = start >> SECTORS_PER_PAGE_SHIFT;
+	     index < end >> SECTORS_PER_PAGE_SHIFT; index++)
+		zram_free_page(zram, index);
+	spin_unlock(&zram->table_lock);
+}
+
+static inline int zram_valid_io(struct bio *bio)
+{
+	return !(bio->bi_sector & (SECTORS_PER_PAGE - 1)) &&
+	       !(bio->bi_size & (PAGE_SIZE - 1));
+}
+
+static int zram_make_request(struct request_queue *queue, struct bio *bio)
+{
+	struct zram *zram = queue->queuedata;
+	struct bio_vec *bvec;
+	u32 index;
+	int i, err = 0;
+
+	if (unlikely(!zram->init_done)) {
+		bio_io_error(bio);
+		return 0;
+	}
+
+	if (bio_rw_flagged(bio, BIO_RW_DISCARD)) {
+		zram_discard(zram, bio);
+		bio_endio(bio, 0);
+		return 0;
+	}
+
+	if (unlikely(!zram_valid_io(bio))) {
+		zram_stat64_inc(zram, &zram->stats.invalid_io);
+		bio_io_error(bio);
+		return 0;
+	}
+
+	if (bio_data_dir(bio) == READ)
+		zram_stat64_inc(zram, &zram->stats.num_reads);
+	else
+		zram_stat64_inc(zram, &zram->stats.num_writes);
+
+	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	bio_for_each_segment(bvec, bio, i) {
+		if (unlikely(bvec->bv_len != PAGE_SIZE || bvec->bv_offset)) {
+			zram_stat64_inc(zram, &zram->stats.invalid_io);
+			err = -EIO;
+			break;
+		}
+
+		if (bio_data_dir(bio) == READ)
+			err = zram_read(zram, bvec->bv_page, index);
+		else
+			err = zram_write(zram, bvec->bv_page, index);
+		if (err)
+			break;
+		index++;
+	}
+
+	bio_endio(bio, err);
+	return 0;
+}
+
+/*
+ * Called by mm/swapfile.c under swap_lock when a swap slot on this device
+ * is no longer used, so the page does not sit compressed in memory until
+ * the slot is written again.
+ */
+static void zram_slot_free_notify(struct block_device *bdev,
+				  unsigned long index)
+{
+	struct zram *zram = bdev->bd_disk->private_data;
+
+	spin_lock(&zram->table_lock);
+	zram_free_page(zram, index);
+	zram->stats.notify_free++;
+	spin_unlock(&zram->table_lock);
+}
+
+static const struct block_device_operations zram_devops = {
+	.swap_slot_free_notify	= zram_slot_free_notify,
+	.owner			= THIS_MODULE,
+};
+
+static int zram_init_device(struct zram *zram)
+{
+	size_t num_pages = zram->disksize >> PAGE_SHIFT;
+
+	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	zram->compress_buffer = kzalloc(lzo1x_worst_compress(PAGE_SIZE),
+					GFP_KERNEL);
+	zram->table = vmalloc(num_pages * sizeof(*zram->table));
+	zram->mem_pool = zpool_create();
+	if (!zram->compress_workmem || !zram->compress_buffer ||
+	    !zram->table || !zram->mem_pool) {
+		kfree(zram->compress_workmem);
+		kfree(zram->compress_buffer);
+		vfree(zram->table);
+		if (zram->mem_pool)
+			zpool_destroy(zram->mem_pool);
+		zram->compress_workmem = NULL;
+		zram->compress_buffer = NULL;
+		zram->table = NULL;
+		zram->mem_pool = NULL;
+		return -ENOMEM;
+	}
+	memset(zram->table, 0, num_pages * sizeof(*zram->table));
+	memset(&zram->stats, 0, sizeof(zram->stats));
+
+	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
+	zram->init_done = 1;
+	return 0;
+}
+
+/* Called with init_lock held, when the device is not open. */
+static void zram_reset_device(struct zram *zram)
+{
+	size_t index, num_pages = zram->disksize >> PAGE_SHIFT;
+
+	zram->init_done = 0;
+	set_capacity(zram->disk, 0);
+
+	spin_lock(&zram->table_lock);
+	for (index = 0; index < num_pages; index++)
+		zram_free_page(zram, index);
+	spin_unlock(&zram->table_lock);
+
+	zpool_destroy(zram->mem_pool);
+	vfree(zram->table);
+	kfree(zram->compress_workmem);
+	kfree(zram->compress_buffer);
+	zram->mem_pool = NULL;
+	zram->table = NULL;
+	zram->compress_workmem = NULL;
+	zram->compress_buffer = NULL;
+	zram->disksize = 0;
+}
+
+/*
+ * sysfs: /sys/block/zramN/
+ */
+static inline struct zram *dev_to_zram(struct device *dev)
+{
+	return dev_to_disk(dev)->private_data;
+}
+
+static ssize_t disksize_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n", dev_to_zram(dev)->disksize);
+}
+
+static ssize_t disksize_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 disksize = PAGE_ALIGN(memparse(buf, NULL));
+	int ret;
+
+	if (!disksize)
+		return -EINVAL;
+
+	mutex_lock(&zram->init_lock);
+	if (zram->init_done) {
+		mutex_unlock(&zram->init_lock);
+		return -EBUSY;
+	}
+	zram->disksize = disksize;
+	ret = zram_init_device(zram);
+	if (ret)
+		zram->disksize = 0;
+	mutex_unlock(&zram->init_lock);
+
+	return ret ? ret : len;
+}
+
+static ssize_t initstate_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", dev_to_zram(dev)->init_done);
+}
+
+static ssize_t reset_store(struct device *dev,
+			   struct device_attribute *attr,
+			   const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct block_device *bdev;
+	int ret = 0;
+
+	bdev = bdget_disk(zram->disk, 0);
+	if (!bdev)
+		return -ENOMEM;
+
+	mutex_lock(&bdev->bd_mutex);
+	mutex_lock(&zram->init_lock);
+	if (bdev->bd_openers) {
+		ret = -EBUSY;
+	} else if (zram->init_done) {
+		invalidate_bh_lrus();
+		truncate_inode_pages(bdev->bd_inode->i_mapping, 0);
+		zram_reset_device(zram);
+	}
+	mutex_unlock(&zram->init_lock);
+	mutex_unlock(&bdev->bd_mutex);
+	bdput(bdev);
+
+	return ret ? ret : len;
+}
+
+#define ZRAM_STAT_ATTR(name)						\
+static ssize_t name##_show(struct device *dev,				\
+			   struct device_attribute *attr, char *buf)	\
+{									\
+	struct zram *zram = dev_to_zram(dev);				\
+									\
+	return sprintf(buf, "%llu\n",					\
+		       zram_stat64_read(zram, &zram->stats.name));	\
+}									\
+static DEVICE_ATTR(name, S_IRUGO, name##_show, NULL)
+
+ZRAM_STAT_ATTR(num_reads);
+ZRAM_STAT_ATTR(num_writes);
+ZRAM_STAT_ATTR(failed_reads);
+ZRAM_STAT_ATTR(failed_writes);
+ZRAM_STAT_ATTR(invalid_io);
+ZRAM_STAT_ATTR(notify_free);
+
+static ssize_t orig_data_size_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%llu\n",
+		       (u64)zram->stats.pages_stored << PAGE_SHIFT);
+}
+
+static ssize_t compr_data_size_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%llu\n",
+		       zram_stat64_read(zram, &zram->stats.compr_size));
+}
+
+/* Uncompressed size over memory used, in hundredths. */
+static ssize_t compr_ratio_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 orig, used = 0, ratio = 0;
+
+	mutex_lock(&zram->init_lock);
+	if (zram->init_done)
+		used = zpool_total_size(zram->mem_pool);
+	mutex_unlock(&zram->init_lock);
+
+	orig = (u64)zram->stats.pages_stored << PAGE_SHIFT;
+	if (used)
+		ratio = div64_u64(orig * 100, used);
+
+	return sprintf(buf, "%llu.%02llu\n", ratio / 100, ratio % 100);
+}
+
+static ssize_t mem_used_total_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u64 val = 0;
+
+	mutex_lock(&zram->init_lock);
+	if (zram->init_done)
+		val = zpool_total_size(zram->mem_pool);
+	mutex_unlock(&zram->init_lock);
+
+	return sprintf(buf, "%llu\n", val);
+}
+
+static DEVICE_ATTR(disksize, S_IRUGO | S_IWUSR, disksize_show, disksize_store);
+static DEVICE_ATTR(initstate, S_IRUGO, initstate_show, NULL);
+static DEVICE_ATTR(reset, S_IWUSR, NULL, reset_store);
+static DEVICE_ATTR(orig_data_size, S_IRUGO, orig_data_size_show, NULL);
+static DEVICE_ATTR(compr_data_size, S_IRUGO, compr_data_size_show, NULL);
+static DEVICE_ATTR(compr_ratio, S_IRUGO, compr_ratio_show, NULL);
+static DEVICE_ATTR(mem_used_total, S_IRUGO, mem_used_total_show, NULL);
+
+static struct attribute *zram_disk_attrs[] = {
+	&dev_attr_disksize.attr,
+	&dev_attr_initstate.attr,
+	&dev_attr_reset.attr,
+	&dev_attr_num_reads.attr,
+	&dev_attr_num_writes.attr,
+	&dev_attr_failed_reads.attr,
+	&dev_attr_failed_writes.attr,
+	&dev_attr_invalid_io.attr,
+	&dev_attr_notify_free.attr,
+	&dev_attr_orig_data_size.attr,
+	&dev_attr_compr_data_size.attr,
+	&dev_attr_compr_ratio.attr,
+	&dev_attr_mem_used_total.attr,
+	NULL,
+};
+
+static struct attribute_group zram_disk_attr_group = {
+	.attrs = zram_disk_attrs,
+};
+
+static int create_device(struct zram *zram, int device_id)
+{
+	int ret;
+
+	mutex_init(&zram->lock);
+	mutex_init(&zram->init_lock);
+	spin_lock_init(&zram->table_lock);
+
+	zram->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!zram->queue) {
+		pr_err("error allocating disk queue for device %d\n",
+		       device_id);
+		return -ENOMEM;
+	}
+
+	blk_queue_make_request(zram->queue, zram_make_request);
+	zram->queue->queuedata = zram;
+	blk_queue_ordered(zram->queue, QUEUE_ORDERED_TAG, NULL);
+	blk_queue_logical_block_size(zram->queue, PAGE_SIZE);
+	blk_queue_bounce_limit(zram->queue, BLK_BOUNCE_ANY);
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->queue);
+	queue_flag_set_unlocked(QUEUE_FLAG_DISCARD, zram->queue);
+	blk_queue_max_discard_sectors(zram->queue,
+			(UINT_MAX >> SECTOR_SHIFT) & ~(SECTORS_PER_PAGE - 1));
+
+	zram->disk = alloc_disk(1);
+	if (!zram->disk) {
+		blk_cleanup_queue(zram->queue);
+		pr_err("error allocating disk structure for device %d\n",
+		       device_id);
+		return -ENOMEM;
+	}
+
+	zram->disk->major = zram_major;
+	zram->disk->first_minor = device_id;
+	zram->disk->fops = &zram_devops;
+	zram->disk->queue = zram->queue;
+	zram->disk->private_data = zram;
+	zram->disk->flags |= GENHD_FL_SUPPRESS_PARTITION_INFO;
+	snprintf(zram->disk->disk_name, 16, "zram%d", device_id);
+
+	/* no capacity until disksize is set */
+	set_capacity(zram->disk, 0);
+	add_disk(zram->disk);
+
+	ret = sysfs_create_group(&disk_to_dev(zram->disk)->kobj,
+				 &zram_disk_attr_group);
+	if (ret < 0) {
+		pr_err("error creating sysfs group for device %d\n",
+		       device_id);
+		del_gendisk(zram->disk);
+		put_disk(zram->disk);
+		blk_cleanup_queue(zram->queue);
+		return ret;
+	}
+
+	return 0;
+}
+
+static void destroy_device(struct zram *zram)
+{
+	sysfs_remove_group(&disk_to_dev(zram->disk)->kobj,
+			   &zram_disk_attr_group);
+	del_gendisk(zram->disk);
+	put_disk(zram->disk);
+	blk_cleanup_queue(zram->queue);
+
+	if (zram->init_done)
+		zram_reset_device(zram);
+}
+
+static int __init zram_init(void)
+{
+	int ret, dev_id;
+
+	if (!num_devices || num_devices > 1U << MINORBITS) {
+		pr_warning("invalid value for num_devices: %u\n",
+			   num_devices);
+		return -EINVAL;
+	}
+
+	zram_major = register_blkdev(0, "zram");
+	if (zram_major <= 0) {
+		pr_warning("unable to get major number\n");
+		return -EBUSY;
+	}
+
+	devices = kzalloc(num_devices * sizeof(*devices), GFP_KERNEL);
+	if (!devices) {
+		ret = -ENOMEM;
+		goto unregister;
+	}
+
+	for (dev_id = 0; dev_id < num_devices; dev_id++) {
+		ret = create_device(&devices[dev_id], dev_id);
+		if (ret)
+			goto free_devices;
+	}
+
+	return 0;
+
+free_devices:
+	while (dev_id)
+		destroy_device(&devices[--dev_id]);
+	kfree(devices);
+unregister:
+	unregister_blkdev(zram_major, "zram");
+	return ret;
+}
+
+static void __exit zram_exit(void)
+{
+	int i;
+
+	for (i = 0; i < num_devices; i++)
+		destroy_device(&devices[i]);
+
+	unregister_blkdev(zram_major, "zram");
+	kfree(devices);
+}
+
+module_init(zram_init);
+module_exit(zram_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Compressed RAM block device");
@@ -0,0 +1,69 @@
+/*
+ * Compressed RAM block device
+ *
+ * This file is released under the GPLv2.
+ */
+
+#ifndef _ZRAM_DRV_H_
+#define _ZRAM_DRV_H_
+
+#include <linux/blkdev.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+
+#include "zpool.h"
+
+#define SECTOR_SHIFT		9
+#define SECTOR_SIZE		(1 << SECTOR_SHIFT)
+#define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
+#define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
+
+/* Pages that compress to more than this are stored as they are. */
+#define ZRAM_MAX_ZPAGE_SIZE	(PAGE_SIZE / 4 * 3)
+
+/* Flags for zram_table_entry.flags */
+enum zram_pageflags {
+	ZRAM_UNCOMPRESSED,
+
+	__NR_ZRAM_PAGEFLAGS,
+};
+
+/* One per page of the device; all zero until the page is written. */
+struct zram_table_entry {
+	void *handle;		/* object in the zpool */
+	u16 size;		/* its size */
+	u8 flags;
+} __attribute__((aligned(4)));
+
+struct zram_stats {
+	u64 compr_size;		/* sum of the sizes of stored objects */
+	u64 num_reads;
+	u64 num_writes;
+	u64 failed_reads;
+	u64 failed_writes;
+	u64 invalid_io;		/* not page aligned */
+	u64 notify_free;	/* swap slots freed */
+	u32 pages_stored;
+	u32 pages_expand;	/* stored uncompressed */
+};
+
+struct zram {
+	struct zpool *mem_pool;
+	/* serializes writers over the compression buffers */
+	struct mutex lock;
+	void *compress_workmem;
+	void *compress_buffer;
+	/* protects table, and stats against 64-bit tearing */
+	spinlock_t table_lock;
+	struct zram_table_entry *table;
+	struct request_queue *queue;
+	struct gendisk *disk;
+	/* disksize and init_done; the device is usable once set */
+	struct mutex init_lock;
+	int init_done;
+	u64 disksize;		/* bytes */
+
+	struct zram_stats stats;
+};
+
+#endif
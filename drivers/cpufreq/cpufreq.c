@@ -28,6 +28,7 @@
 #include <linux/cpu.h>
 #include <linux/completion.h>
 #include <linux/mutex.h>
+#include <linux/sched.h>
 
 #define dprintk(msg...) cpufreq_debug_printk(CPUFREQ_DEBUG_CORE, \
 						"cpufreq-core", msg)
@@ -1633,6 +1634,27 @@ int __cpufreq_driver_getavg(struct cpufreq_policy *policy, unsigned int cpu)
 }
 EXPORT_SYMBOL_GPL(__cpufreq_driver_getavg);
 
+/**
+ * cpufreq_sched_max - highest speed wanted by what ran on a policy's CPUs
+ * @policy: the policy
+ *
+ * Tasks in a cpu cgroup with cpu.max_freq set ask not to be run above that
+ * speed.  Returns the highest frequency that the tasks that ran on the
+ * policy's CPUs since the last call allow, within the policy limits.
+ * Governors call this once per sample and use it instead of policy->max.
+ */
+unsigned int cpufreq_sched_max(struct cpufreq_policy *policy)
+{
+	unsigned int max = 0;
+	unsigned int j;
+
+	for_each_cpu(j, policy->cpus)
+		max = max(max, sched_get_freq_cap(j));
+
+	return clamp(max, policy->min, policy->max);
+}
+EXPORT_SYMBOL_GPL(cpufreq_sched_max);
+
 /*
  * when "event" is CPUFREQ_GOV_LIMITS
  */
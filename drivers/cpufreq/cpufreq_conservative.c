@@ -388,6 +388,7 @@ extern int dvfs_change_quick;
 static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 {
 	unsigned int load = 0;
+	unsigned int max;
 #ifndef CONFIG_CPU_S5PV210
 	unsigned int freq_target;
 #endif
@@ -456,6 +457,9 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 	if (dbs_tuners_ins.freq_step == 0)
 		return;
 
+	/* the cpu cgroups of what ran may not want full speed */
+	max = cpufreq_sched_max(policy);
+
 	/* Check for frequency increase */
 
 #if defined (CONFIG_CPU_S5PV210)
@@ -467,7 +471,7 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		this_dbs_info->down_skip = 0;
 
 		/* if we are already at full speed then break out early */
-		if (this_dbs_info->requested_freq == policy->max)
+		if (this_dbs_info->requested_freq == max)
 			return;
 
 #ifndef CONFIG_CPU_S5PV210
@@ -482,14 +486,20 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		this_dbs_info->requested_freq = s5pc11x_target_frq(this_dbs_info->requested_freq, 1);
 #endif
 
-		if (this_dbs_info->requested_freq > policy->max)
-			this_dbs_info->requested_freq = policy->max;
+		if (this_dbs_info->requested_freq > max)
+			this_dbs_info->requested_freq = max;
 
 		__cpufreq_driver_target(policy, this_dbs_info->requested_freq,
 			CPUFREQ_RELATION_H);
 		return;
 	}
 
+	if (this_dbs_info->requested_freq > max) {
+		this_dbs_info->requested_freq = max;
+		__cpufreq_driver_target(policy, max, CPUFREQ_RELATION_H);
+		return;
+	}
+
 	/*
 	 * The optimal frequency is the frequency that is the lowest that
 	 * can support the current CPU usage without triggering the up
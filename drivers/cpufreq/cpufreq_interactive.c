@@ -0,0 +1,585 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive.c
+ *
+ *  A latency oriented cpufreq governor. Load is sampled every timer_rate
+ *  while the CPU is busy. When load crosses go_hispeed_load, or on input
+ *  activity, the governor jumps straight to hispeed_freq (and past it in
+ *  proportion to load) instead of stepping up. It only steps back down
+ *  once the current speed has been held for min_sample_time.
+ *
+ *  While the CPU runs at the policy minimum the sample timer is deferrable,
+ *  so an idle CPU is not woken; the first sample after idle exit is then
+ *  taken on the first tick.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/cpu.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/kernel_stat.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/tick.h>
+#include <linux/ktime.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+
+#define DEF_GO_HISPEED_LOAD			(85)
+#define DEF_MIN_SAMPLE_TIME			(80 * USEC_PER_MSEC)
+#define DEF_TIMER_RATE				(20 * USEC_PER_MSEC)
+#define TRANSITION_LATENCY_LIMIT		(10 * 1000 * 1000)
+
+struct cpufreq_interactive_cpuinfo {
+	struct cpufreq_policy *policy;
+	struct timer_list timer;	/* sampling above policy->min */
+	struct timer_list idle_timer;	/* deferrable, at policy->min */
+	struct work_struct work;	/* applies target_freq */
+	u64 prev_cpu_idle;
+	u64 prev_cpu_wall;
+	u64 floor_time;			/* when we last went up, in usecs */
+	unsigned int target_freq;
+	int cpu;
+	unsigned int enable:1;
+	/*
+	 * serializes frequency changes from the work with governor limit
+	 * changes
+	 */
+	struct mutex mutex;
+};
+static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, interactive_cpuinfo);
+
+static unsigned int interactive_enable;	/* number of CPUs using us */
+static int interactive_input_registered;
+
+/*
+ * interactive_mutex protects the tunables from concurrent changes and
+ * interactive_enable in governor start/stop.
+ */
+static DEFINE_MUTEX(interactive_mutex);
+
+static struct workqueue_struct *kinteractive_wq;
+
+static struct interactive_tuners {
+	unsigned int hispeed_freq;	/* 0 means policy->max */
+	unsigned int go_hispeed_load;
+	unsigned int min_sample_time;
+	unsigned int timer_rate;
+	unsigned int input_boost;
+} interactive_tuners_ins = {
+	.go_hispeed_load = DEF_GO_HISPEED_LOAD,
+	.min_sample_time = DEF_MIN_SAMPLE_TIME,
+	.timer_rate = DEF_TIMER_RATE,
+	.input_boost = 1,
+};
+
+static inline u64 interactive_now(void)
+{
+	return ktime_to_us(ktime_get());
+}
+
+static unsigned int interactive_hispeed(struct cpufreq_policy *policy)
+{
+	unsigned int hispeed = interactive_tuners_ins.hispeed_freq;
+
+	if (!hispeed || hispeed > policy->max)
+		hispeed = policy->max;
+	if (hispeed < policy->min)
+		hispeed = policy->min;
+	return hispeed;
+}
+
+static inline u64 get_cpu_idle_time_jiffy(unsigned int cpu, u64 *wall)
+{
+	cputime64_t idle_time;
+	cputime64_t cur_wall_time;
+	cputime64_t busy_time;
+
+	cur_wall_time = jiffies64_to_cputime64(get_jiffies_64());
+	busy_time = cputime64_add(kstat_cpu(cpu).cpustat.user,
+			kstat_cpu(cpu).cpustat.system);
+
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.irq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.softirq);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.steal);
+	busy_time = cputime64_add(busy_time, kstat_cpu(cpu).cpustat.nice);
+
+	idle_time = cputime64_sub(cur_wall_time, busy_time);
+	if (wall)
+		*wall = (u64)jiffies_to_usecs(cur_wall_time);
+
+	return (u64)jiffies_to_usecs(idle_time);
+}
+
+/* without NO_HZ there is no idle time in usecs, fall back to the tick */
+static inline u64 get_cpu_idle_time(unsigned int cpu, u64 *wall)
+{
+	u64 idle_time = get_cpu_idle_time_us(cpu, wall);
+
+	if (idle_time == -1ULL)
+		return get_cpu_idle_time_jiffy(cpu, wall);
+
+	return idle_time;
+}
+
+/* arm whichever sample timer suits the current speed */
+static void interactive_timer_start(struct cpufreq_interactive_cpuinfo *info)
+{
+	unsigned long expires = jiffies +
+		usecs_to_jiffies(interactive_tuners_ins.timer_rate);
+
+	if (info->policy->cur > info->policy->min)
+		mod_timer(&info->timer, expires);
+	else
+		mod_timer(&info->idle_timer, expires);
+}
+
+/* the highest load of the CPUs in the policy since the last sample */
+static unsigned int interactive_load(struct cpufreq_policy *policy)
+{
+	unsigned int load = 0;
+	unsigned int j;
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_interactive_cpuinfo *j_info;
+		u64 cur_wall_time, cur_idle_time;
+		unsigned int idle_time, wall_time;
+
+		j_info = &per_cpu(interactive_cpuinfo, j);
+		cur_idle_time = get_cpu_idle_time(j, &cur_wall_time);
+		wall_time = (unsigned int)(cur_wall_time -
+					   j_info->prev_cpu_wall);
+		j_info->prev_cpu_wall = cur_wall_time;
+		idle_time = (unsigned int)(cur_idle_time -
+					   j_info->prev_cpu_idle);
+		j_info->prev_cpu_idle = cur_idle_time;
+
+		if (unlikely(!wall_time || wall_time < idle_time))
+			continue;
+
+		load = max(load, 100 * (wall_time - idle_time) / wall_time);
+	}
+
+	return load;
+}
+
+static void interactive_timer(unsigned long data)
+{
+	struct cpufreq_interactive_cpuinfo *info =
+		&per_cpu(interactive_cpuinfo, data);
+	struct cpufreq_policy *policy = info->policy;
+	unsigned int hispeed, load, target, max;
+	u64 now;
+
+	if (!info->enable)
+		return;
+
+	load = interactive_load(policy);
+	hispeed = interactive_hispeed(policy);
+	max = cpufreq_sched_max(policy);
+	now = interactive_now();
+
+	/* the lowest speed the current work would keep ~100% busy */
+	target = policy->cur * load / 100;
+	if (load >= interactive_tuners_ins.go_hispeed_load) {
+		if (policy->cur < hispeed)
+			target = hispeed;
+		else
+			target = policy->max * load / 100;
+	}
+	if (target > max)
+		target = max;
+	if (target < policy->min)
+		target = policy->min;
+
+	if (target >= policy->cur) {
+		if (target > policy->cur)
+			info->floor_time = now;
+	} else if (now - info->floor_time <
+		   interactive_tuners_ins.min_sample_time) {
+		/* hold the speed we went up to for a while */
+		target = min(policy->cur, max);
+	}
+
+	if (target != policy->cur) {
+		info->target_freq = target;
+		queue_work(kinteractive_wq, &info->work);
+	}
+
+	interactive_timer_start(info);
+}
+
+static void interactive_work(struct work_struct *work)
+{
+	struct cpufreq_interactive_cpuinfo *info =
+		container_of(work, struct cpufreq_interactive_cpuinfo, work);
+
+	mutex_lock(&info->mutex);
+	/* the next sample rearms the timer that suits the new speed */
+	if (info->enable && info->target_freq != info->policy->cur)
+		__cpufreq_driver_target(info->policy, info->target_freq,
+					CPUFREQ_RELATION_L);
+	mutex_unlock(&info->mutex);
+}
+
+/*
+ * Input activity: go to hispeed_freq right away, ahead of the load the
+ * touch or key press is about to cause.
+ */
+static void interactive_input_event(struct input_handle *handle,
+				    unsigned int type, unsigned int code,
+				    int value)
+{
+	u64 now;
+	unsigned int j;
+
+	if (!interactive_tuners_ins.input_boost || !interactive_enable)
+		return;
+
+	now = interactive_now();
+	for_each_online_cpu(j) {
+		struct cpufreq_interactive_cpuinfo *info =
+			&per_cpu(interactive_cpuinfo, j);
+		unsigned int hispeed;
+
+		if (!info->enable || info->policy->cpu != j)
+			continue;
+		hispeed = interactive_hispeed(info->policy);
+		info->floor_time = now;
+		if (info->policy->cur < hispeed) {
+			info->target_freq = hispeed;
+			queue_work(kinteractive_wq, &info->work);
+		}
+	}
+}
+
+static int interactive_input_connect(struct input_handler *handler,
+				     struct input_dev *dev,
+				     const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void interactive_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id interactive_input_ids[] = {
+	{
+		/* touchscreens */
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	{
+		/* single touch touchscreens and touchpads */
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	{
+		/* keys and buttons */
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler interactive_input_handler = {
+	.event		= interactive_input_event,
+	.connect	= interactive_input_connect,
+	.disconnect	= interactive_input_disconnect,
+	.name		= "cpufreq_interactive",
+	.id_table	= interactive_input_ids,
+};
+
+/************************** sysfs interface ************************/
+#define show_one(file_name, object)					\
+static ssize_t show_##file_name						\
+(struct cpufreq_policy *unused, char *buf)				\
+{									\
+	return sprintf(buf, "%u\n", interactive_tuners_ins.object);	\
+}
+show_one(hispeed_freq, hispeed_freq);
+show_one(go_hispeed_load, go_hispeed_load);
+show_one(min_sample_time, min_sample_time);
+show_one(timer_rate, timer_rate);
+show_one(input_boost, input_boost);
+
+static ssize_t store_hispeed_freq(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.hispeed_freq = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_go_hispeed_load(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	if (ret != 1 || input > 100)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.go_hispeed_load = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_min_sample_time(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.min_sample_time = input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_timer_rate(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	if (ret != 1)
+		return -EINVAL;
+
+	/* the timers are jiffy based */
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.timer_rate = max(input, jiffies_to_usecs(1));
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+static ssize_t store_input_boost(struct cpufreq_policy *unused,
+		const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+	ret = sscanf(buf, "%u", &input);
+
+	if (ret != 1)
+		return -EINVAL;
+
+	mutex_lock(&interactive_mutex);
+	interactive_tuners_ins.input_boost = !!input;
+	mutex_unlock(&interactive_mutex);
+
+	return count;
+}
+
+#define define_one_rw(_name) \
+static struct freq_attr _name = \
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+define_one_rw(hispeed_freq);
+define_one_rw(go_hispeed_load);
+define_one_rw(min_sample_time);
+define_one_rw(timer_rate);
+define_one_rw(input_boost);
+
+static struct attribute *interactive_attributes[] = {
+	&hispeed_freq.attr,
+	&go_hispeed_load.attr,
+	&min_sample_time.attr,
+	&timer_rate.attr,
+	&input_boost.attr,
+	NULL
+};
+
+static struct attribute_group interactive_attr_group = {
+	.attrs = interactive_attributes,
+	.name = "interactive",
+};
+
+/************************** sysfs end ************************/
+
+static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
+					unsigned int event)
+{
+	unsigned int cpu = policy->cpu;
+	struct cpufreq_interactive_cpuinfo *this_info;
+	unsigned int j;
+	int rc;
+
+	this_info = &per_cpu(interactive_cpuinfo, cpu);
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if ((!cpu_online(cpu)) || (!policy->cur))
+			return -EINVAL;
+
+		mutex_lock(&interactive_mutex);
+
+		rc = sysfs_create_group(&policy->kobj, &interactive_attr_group);
+		if (rc) {
+			mutex_unlock(&interactive_mutex);
+			return rc;
+		}
+
+		for_each_cpu(j, policy->cpus) {
+			struct cpufreq_interactive_cpuinfo *j_info;
+			j_info = &per_cpu(interactive_cpuinfo, j);
+			j_info->policy = policy;
+			j_info->prev_cpu_idle = get_cpu_idle_time(j,
+						&j_info->prev_cpu_wall);
+		}
+		this_info->cpu = cpu;
+		this_info->floor_time = interactive_now();
+		this_info->target_freq = policy->cur;
+		mutex_init(&this_info->mutex);
+		INIT_WORK(&this_info->work, interactive_work);
+		setup_timer(&this_info->timer, interactive_timer, cpu);
+		init_timer_deferrable(&this_info->idle_timer);
+		this_info->idle_timer.function = interactive_timer;
+		this_info->idle_timer.data = cpu;
+
+		if (interactive_enable++ == 0) {
+			rc = input_register_handler(&interactive_input_handler);
+			if (rc)
+				printk(KERN_WARNING "cpufreq_interactive: "
+				       "input boost unavailable (%d)\n", rc);
+			interactive_input_registered = !rc;
+		}
+		mutex_unlock(&interactive_mutex);
+
+		this_info->enable = 1;
+		interactive_timer_start(this_info);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		this_info->enable = 0;
+		del_timer_sync(&this_info->timer);
+		del_timer_sync(&this_info->idle_timer);
+		cancel_work_sync(&this_info->work);
+
+		mutex_lock(&interactive_mutex);
+		sysfs_remove_group(&policy->kobj, &interactive_attr_group);
+		if (--interactive_enable == 0 && interactive_input_registered) {
+			input_unregister_handler(&interactive_input_handler);
+			interactive_input_registered = 0;
+		}
+		mutex_destroy(&this_info->mutex);
+		mutex_unlock(&interactive_mutex);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&this_info->mutex);
+		if (policy->max < this_info->policy->cur)
+			__cpufreq_driver_target(this_info->policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > this_info->policy->cur)
+			__cpufreq_driver_target(this_info->policy,
+					policy->min, CPUFREQ_RELATION_L);
+		mutex_unlock(&this_info->mutex);
+		break;
+	}
+	return 0;
+}
+
+struct cpufreq_governor cpufreq_gov_interactive = {
+	.name			= "interactive",
+	.governor		= cpufreq_governor_interactive,
+	.max_transition_latency	= TRANSITION_LATENCY_LIMIT,
+	.owner			= THIS_MODULE,
+};
+EXPORT_SYMBOL_GPL(cpufreq_gov_interactive);
+
+static int __init cpufreq_gov_interactive_init(void)
+{
+	int err;
+
+	/* frequency changes may sleep, so they are done from here */
+	kinteractive_wq = create_rt_workqueue("kinteractive");
+	if (!kinteractive_wq) {
+		printk(KERN_ERR "Creation of kinteractive failed\n");
+		return -EFAULT;
+	}
+
+	err = cpufreq_register_governor(&cpufreq_gov_interactive);
+	if (err)
+		destroy_workqueue(kinteractive_wq);
+
+	return err;
+}
+
+static void __exit cpufreq_gov_interactive_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+	destroy_workqueue(kinteractive_wq);
+}
+
+MODULE_DESCRIPTION("'cpufreq_interactive' - A cpufreq governor for "
+		"latency sensitive workloads that ramps up on load spikes "
+		"and input events");
+MODULE_LICENSE("GPL");
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE
+fs_initcall(cpufreq_gov_interactive_init);
+#else
+module_init(cpufreq_gov_interactive_init);
+#endif
+module_exit(cpufreq_gov_interactive_exit);
@@ -0,0 +1,336 @@
+/*
+ *  drivers/cpufreq/cpufreq_interactive_test.c
+ *
+ *  Ramp-up latency test for the 'interactive' governor. A fake cpufreq
+ *  driver is registered with the governor as its default. CPU 0 is
+ *  left idle until it drops to the lowest speed, then either kept busy
+ *  by a spinning thread or sent a key press from a fake input device.
+ *  The time until the speed first goes up and until it reaches the top
+ *  is logged for each case over 'runs' rounds.
+ *
+ *  Only one cpufreq driver can be registered at a time, so the platform
+ *  driver must not be loaded.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/completion.h>
+#include <linux/delay.h>
+#include <linux/input.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+
+#define TEST_CPU		0
+#define TEST_TIMEOUT_US		(1000 * USEC_PER_MSEC)
+
+static int runs = 5;
+module_param(runs, int, S_IRUGO);
+MODULE_PARM_DESC(runs, "rounds of each test");
+
+static int idle_ms = 500;
+module_param(idle_ms, int, S_IRUGO);
+MODULE_PARM_DESC(idle_ms, "idle time before each round");
+
+static struct cpufreq_frequency_table test_freq_table[] = {
+	{ 0, 100000 },
+	{ 1, 200000 },
+	{ 2, 400000 },
+	{ 3, 800000 },
+	{ 4, 1000000 },
+	{ 0, CPUFREQ_TABLE_END },
+};
+
+static DEFINE_PER_CPU(unsigned int, test_cur);
+static DECLARE_WAIT_QUEUE_HEAD(test_wait);
+static DECLARE_COMPLETION(test_done);
+static struct input_dev *test_input;
+static unsigned int test_top;		/* policy->max of TEST_CPU */
+
+/* first raise and top speed latencies of one test, in usecs */
+struct test_result {
+	const char *name;
+	unsigned int rounds, missed;
+	u64 raise_min, raise_max, raise_sum;
+	u64 top_min, top_max, top_sum;
+};
+
+static int test_verify(struct cpufreq_policy *policy)
+{
+	return cpufreq_frequency_table_verify(policy, test_freq_table);
+}
+
+static int test_target(struct cpufreq_policy *policy,
+		       unsigned int target_freq, unsigned int relation)
+{
+	struct cpufreq_freqs freqs;
+	unsigned int index;
+	int ret;
+
+	ret = cpufreq_frequency_table_target(policy, test_freq_table,
+					     target_freq, relation, &index);
+	if (ret)
+		return ret;
+
+	freqs.cpu = policy->cpu;
+	freqs.old = policy->cur;
+	freqs.new = test_freq_table[index].frequency;
+	freqs.flags = 0;
+	if (freqs.old == freqs.new)
+		return 0;
+
+	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+	per_cpu(test_cur, policy->cpu) = freqs.new;
+	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
+	wake_up(&test_wait);
+
+	return 0;
+}
+
+static unsigned int test_get(unsigned int cpu)
+{
+	return per_cpu(test_cur, cpu);
+}
+
+static int test_cpu_init(struct cpufreq_policy *policy)
+{
+	int ret;
+
+	ret = cpufreq_frequency_table_cpuinfo(policy, test_freq_table);
+	if (ret)
+		return ret;
+	cpufreq_frequency_table_get_attr(test_freq_table, policy->cpu);
+
+	policy->cpuinfo.transition_latency = 100 * NSEC_PER_USEC;
+	policy->cur = policy->cpuinfo.min_freq;
+	per_cpu(test_cur, policy->cpu) = policy->cur;
+	policy->governor = &cpufreq_gov_interactive;
+
+	return 0;
+}
+
+static int test_cpu_exit(struct cpufreq_policy *policy)
+{
+	cpufreq_frequency_table_put_attr(policy->cpu);
+	return 0;
+}
+
+static struct cpufreq_driver test_driver = {
+	.name		= "interactive_test",
+	.owner		= THIS_MODULE,
+	.verify		= test_verify,
+	.target		= test_target,
+	.get		= test_get,
+	.init		= test_cpu_init,
+	.exit		= test_cpu_exit,
+};
+
+static inline u64 test_now(void)
+{
+	return ktime_to_us(ktime_get());
+}
+
+static unsigned int test_speed(void)
+{
+	return per_cpu(test_cur, TEST_CPU);
+}
+
+/* let CPU 0 go idle until the governor has taken it down to the minimum */
+static int test_settle(void)
+{
+	msleep(idle_ms);
+	return wait_event_timeout(test_wait,
+		test_speed() == test_freq_table[0].frequency, 2 * HZ) ? 0 : -1;
+}
+
+static void test_record(struct test_result *res, u64 start, u64 raise,
+			u64 top)
+{
+	if (!raise || !top) {
+		res->missed++;
+		return;
+	}
+	raise -= start;
+	top -= start;
+	if (!res->rounds || raise < res->raise_min)
+		res->raise_min = raise;
+	if (!res->rounds || top < res->top_min)
+		res->top_min = top;
+	res->raise_max = max(res->raise_max, raise);
+	res->top_max = max(res->top_max, top);
+	res->raise_sum += raise;
+	res->top_sum += top;
+	res->rounds++;
+}
+
+/* spin on CPU 0 until the governor has brought it to the top speed */
+static void test_load(struct test_result *res)
+{
+	unsigned int min = test_freq_table[0].frequency;
+	u64 start, now, raise = 0;
+
+	start = now = test_now();
+	while (now - start < TEST_TIMEOUT_US) {
+		if (!raise && test_speed() > min)
+			raise = now;
+		if (test_speed() >= test_top)
+			break;
+		/* the governor applies changes from an RT workqueue */
+		cond_resched();
+		now = test_now();
+	}
+	test_record(res, start, raise, test_speed() >= test_top ? now : 0);
+}
+
+/* press a key on an idle CPU 0 and wait for the boost */
+static void test_key(struct test_result *res)
+{
+	unsigned int min = test_freq_table[0].frequency;
+	u64 start, raise = 0;
+
+	start = test_now();
+	input_report_key(test_input, KEY_PROG1, 1);
+	input_sync(test_input);
+	input_report_key(test_input, KEY_PROG1, 0);
+	input_sync(test_input);
+
+	if (wait_event_timeout(test_wait, test_speed() > min, HZ))
+		raise = test_now();
+	if (raise && test_speed() < test_top)
+		wait_event_timeout(test_wait, test_speed() >= test_top, HZ);
+	test_record(res, start, raise,
+		    test_speed() >= test_top ? test_now() : 0);
+}
+
+static void test_report(struct test_result *res)
+{
+	if (!res->rounds) {
+		printk(KERN_INFO "cpufreq_interactive_test: %s: no ramp-up "
+		       "in %u rounds\n", res->name, res->missed);
+		return;
+	}
+	printk(KERN_INFO "cpufreq_interactive_test: %s: first raise "
+	       "%llu/%llu/%llu us, top speed %llu/%llu/%llu us "
+	       "(min/avg/max, %u rounds, %u missed)\n", res->name,
+	       res->raise_min, div_u64(res->raise_sum, res->rounds),
+	       res->raise_max, res->top_min,
+	       div_u64(res->top_sum, res->rounds), res->top_max,
+	       res->rounds, res->missed);
+}
+
+static int test_thread(void *unused)
+{
+	struct test_result load = { .name = "load" };
+	struct test_result key = { .name = "key press" };
+	int i;
+
+	for (i = 0; i < runs; i++) {
+		if (test_settle()) {
+			load.missed++;
+			continue;
+		}
+		test_load(&load);
+	}
+	for (i = 0; test_input && i < runs; i++) {
+		if (test_settle()) {
+			key.missed++;
+			continue;
+		}
+		test_key(&key);
+	}
+
+	test_report(&load);
+	if (test_input)
+		test_report(&key);
+	complete(&test_done);
+	return 0;
+}
+
+static int test_input_register(void)
+{
+	int ret;
+
+	test_input = input_allocate_device();
+	if (!test_input)
+		return -ENOMEM;
+	test_input->name = "cpufreq_interactive_test";
+	set_bit(EV_KEY, test_input->evbit);
+	set_bit(KEY_PROG1, test_input->keybit);
+
+	ret = input_register_device(test_input);
+	if (ret) {
+		input_free_device(test_input);
+		test_input = NULL;
+	}
+	return ret;
+}
+
+static int __init cpufreq_interactive_test_init(void)
+{
+	struct cpufreq_policy *policy;
+	struct task_struct *thread;
+	int ret;
+
+	ret = cpufreq_register_driver(&test_driver);
+	if (ret) {
+		printk(KERN_ERR "cpufreq_interactive_test: cannot register "
+		       "the fake driver (%d), is another one loaded?\n", ret);
+		return ret;
+	}
+
+	policy = cpufreq_cpu_get(TEST_CPU);
+	if (policy) {
+		if (policy->governor == &cpufreq_gov_interactive)
+			test_top = policy->max;
+		cpufreq_cpu_put(policy);
+	}
+	if (!test_top) {
+		printk(KERN_ERR "cpufreq_interactive_test: CPU %d does not "
+		       "run the interactive governor\n", TEST_CPU);
+		ret = -ENODEV;
+		goto err_driver;
+	}
+
+	if (test_input_register())
+		printk(KERN_WARNING "cpufreq_interactive_test: no input "
+		       "device, skipping the key press test\n");
+
+	thread = kthread_create(test_thread, NULL, "cpufreq_test");
+	if (IS_ERR(thread)) {
+		ret = PTR_ERR(thread);
+		goto err_input;
+	}
+	kthread_bind(thread, TEST_CPU);
+	wake_up_process(thread);
+	wait_for_completion(&test_done);
+
+	return 0;
+
+err_input:
+	if (test_input)
+		input_unregister_device(test_input);
+err_driver:
+	cpufreq_unregister_driver(&test_driver);
+	return ret;
+}
+
+static void __exit cpufreq_interactive_test_exit(void)
+{
+	if (test_input)
+		input_unregister_device(test_input);
+	cpufreq_unregister_driver(&test_driver);
+}
+
+MODULE_DESCRIPTION("Ramp-up latency test for the 'interactive' cpufreq "
+		"governor");
+MODULE_LICENSE("GPL");
+
+module_init(cpufreq_interactive_test_init);
+module_exit(cpufreq_interactive_test_exit);
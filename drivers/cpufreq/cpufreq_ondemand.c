@@ -446,6 +446,7 @@ static struct attribute_group dbs_attr_group_old = {
 static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 {
 	unsigned int max_load_freq;
+	unsigned int max;
 
 	struct cpufreq_policy *policy;
 	unsigned int j;
@@ -518,17 +519,20 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 			max_load_freq = load_freq;
 	}
 
+	/* the cpu cgroups of what ran may not want full speed */
+	max = cpufreq_sched_max(policy);
+
 	/* Check for frequency increase */
 	if (max_load_freq > dbs_tuners_ins.up_threshold * policy->cur) {
 		/* if we are already at full speed then break out early */
 		if (!dbs_tuners_ins.powersave_bias) {
-			if (policy->cur == policy->max)
+			if (policy->cur == max)
 				return;
 
-			__cpufreq_driver_target(policy, policy->max,
+			__cpufreq_driver_target(policy, max,
 				CPUFREQ_RELATION_H);
 		} else {
-			int freq = powersave_bias_target(policy, policy->max,
+			int freq = powersave_bias_target(policy, max,
 					CPUFREQ_RELATION_H);
 			__cpufreq_driver_target(policy, freq,
 				CPUFREQ_RELATION_L);
@@ -536,6 +540,11 @@ static void dbs_check_cpu(struct cpu_dbs_info_s *this_dbs_info)
 		return;
 	}
 
+	if (policy->cur > max) {
+		__cpufreq_driver_target(policy, max, CPUFREQ_RELATION_H);
+		return;
+	}
+
 	/* Check for frequency decrease */
 	/* if we cannot reduce the frequency anymore, break out early */
 	if (policy->cur == policy->min)
@@ -19,6 +19,13 @@
 #include <linux/kobject.h>
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
+#include <linux/hash.h>
+#include <linux/proc_fs.h>
+#include <linux/rculist.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
@@ -155,6 +162,314 @@ static struct attribute_group stats_attr_group = {
 	.name = "stats"
 };
 
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+/*
+ * Per-uid CPU time at each frequency, and wakeups, for power attribution.
+ *
+ * /proc/uid_time_in_state is binary, in native byte order:
+ *
+ *	struct uid_time_in_state_header;
+ *	u32 freq[nr_freqs];		kHz, as in time_in_state
+ *	nr_uids times:
+ *		struct uid_time_in_state_record;
+ *		u64 time[nr_freqs];	in units of 1/clock_ticks s
+ *
+ * CPU time is charged at tick granularity to the frequency the CPU was
+ * running at.  Wakeups are voluntary context switches, i.e. how many times
+ * a thread of that uid went to sleep and was woken again; those of exited
+ * threads are folded in when they are released.  Entries are never freed;
+ * an Android device has a few hundred uids at most.
+ *
+ * The tick only looks at the per-cpu index of the current frequency, not
+ * at the CPU's stats table, which can go away with the CPU.  Entries are
+ * added to the hash under uid_lock and looked up with RCU.
+ */
+struct uid_time_in_state_header {
+	u32 version;
+	u32 nr_freqs;
+	u32 nr_uids;
+	u32 clock_ticks;
+};
+
+struct uid_time_in_state_record {
+	u32 uid;
+	u32 reserved;
+	u64 wakeups;
+};
+
+struct uid_entry {
+	struct hlist_node hash;
+	uid_t uid;
+	u64 dead_wakeups;
+	u64 live_wakeups;		/* under uid_read_mutex */
+	cputime64_t time_in_state[0];
+};
+
+#define UID_HASH_BITS	6
+static struct hlist_head uid_hash_table[1 << UID_HASH_BITS];
+static DEFINE_SPINLOCK(uid_lock);
+static DEFINE_MUTEX(uid_read_mutex);
+static unsigned int uid_nr_entries;
+/* a copy of the first CPU's frequency table, the layout of time_in_state */
+static unsigned int uid_state_num;
+static unsigned int *uid_freq_table;
+/* index in uid_freq_table of each CPU's current frequency, or -1 */
+static DEFINE_PER_CPU(int, uid_freq_index) = -1;
+
+static struct uid_entry *find_uid_entry(uid_t uid)
+{
+	struct hlist_head *head = &uid_hash_table[hash_long(uid,
+							   UID_HASH_BITS)];
+	struct hlist_node *node;
+	struct uid_entry *entry;
+
+	hlist_for_each_entry_rcu(entry, node, head, hash)
+		if (entry->uid == uid)
+			return entry;
+	return NULL;
+}
+
+static struct uid_entry *find_or_alloc_uid_entry(uid_t uid)
+{
+	struct uid_entry *entry;
+
+	entry = find_uid_entry(uid);
+	if (entry)
+		return entry;
+
+	entry = kzalloc(sizeof(*entry) +
+			uid_state_num * sizeof(entry->time_in_state[0]),
+			GFP_ATOMIC);
+	if (!entry)
+		return NULL;
+	entry->uid = uid;
+	hlist_add_head_rcu(&entry->hash,
+			   &uid_hash_table[hash_long(uid, UID_HASH_BITS)]);
+	uid_nr_entries++;
+	return entry;
+}
+
+static void cpufreq_stats_uid_set_freq(unsigned int cpu, unsigned int freq)
+{
+	int index = -1;
+	unsigned int i;
+
+	for (i = 0; i < uid_state_num; i++)
+		if (uid_freq_table[i] == freq)
+			index = i;
+	per_cpu(uid_freq_index, cpu) = index;
+}
+
+static void cpufreq_stats_uid_clear_freq(unsigned int cpu)
+{
+	per_cpu(uid_freq_index, cpu) = -1;
+}
+
+static uid_t cpufreq_stats_task_uid(struct task_struct *p)
+{
+	uid_t uid;
+
+	rcu_read_lock();
+	uid = task_uid(p);
+	rcu_read_unlock();
+	return uid;
+}
+
+/**
+ * cpufreq_stats_uid_account - charge CPU time to a task's uid
+ * @p: the task that used the time, on this CPU
+ * @cputime: how much
+ *
+ * Called from the scheduler's tick accounting.
+ */
+void cpufreq_stats_uid_account(struct task_struct *p, cputime_t cputime)
+{
+	struct uid_entry *entry;
+	unsigned long flags;
+	int index;
+	uid_t uid;
+
+	index = per_cpu(uid_freq_index, smp_processor_id());
+	if (index < 0)
+		return;
+
+	uid = cpufreq_stats_task_uid(p);
+	spin_lock_irqsave(&uid_lock, flags);
+	entry = find_or_alloc_uid_entry(uid);
+	if (entry)
+		entry->time_in_state[index] =
+			cputime64_add(entry->time_in_state[index],
+				      cputime_to_cputime64(cputime));
+	spin_unlock_irqrestore(&uid_lock, flags);
+}
+
+/**
+ * cpufreq_stats_uid_exit - keep the wakeups of a released thread
+ * @p: the thread, just unhashed
+ *
+ * Called from release_task() under tasklist_lock, so that a reader that
+ * holds it counts each thread either live or here, never both or neither.
+ */
+void cpufreq_stats_uid_exit(struct task_struct *p)
+{
+	struct uid_entry *entry;
+	unsigned long flags;
+	uid_t uid;
+
+	if (!uid_state_num)
+		return;
+
+	uid = cpufreq_stats_task_uid(p);
+	spin_lock_irqsave(&uid_lock, flags);
+	entry = find_or_alloc_uid_entry(uid);
+	if (entry)
+		entry->dead_wakeups += p->nvcsw;
+	spin_unlock_irqrestore(&uid_lock, flags);
+}
+
+struct uid_time_in_state_buf {
+	size_t len;
+	char data[0];
+};
+
+static int uid_time_in_state_open(struct inode *inode, struct file *file)
+{
+	struct uid_time_in_state_header *hdr;
+	struct uid_time_in_state_buf *buf;
+	struct task_struct *g, *t;
+	struct hlist_node *node;
+	struct uid_entry *entry;
+	unsigned long flags;
+	size_t rec_size, size;
+	unsigned int nr, max_nr, i, j;
+	char *p;
+
+	if (!uid_state_num)
+		return -ENODEV;
+
+	mutex_lock(&uid_read_mutex);
+
+	/* leave room for uids that show up while we walk the threads */
+	rec_size = sizeof(struct uid_time_in_state_record) +
+		   uid_state_num * sizeof(u64);
+	max_nr = uid_nr_entries + 16;
+	size = sizeof(*buf) + sizeof(*hdr) + uid_state_num * sizeof(u32) +
+	       max_nr * rec_size;
+	buf = vmalloc(size);
+	if (!buf) {
+		mutex_unlock(&uid_read_mutex);
+		return -ENOMEM;
+	}
+
+	hdr = (struct uid_time_in_state_header *)buf->data;
+	hdr->version = 1;
+	hdr->nr_freqs = uid_state_num;
+	hdr->clock_ticks = USER_HZ;
+	p = (char *)(hdr + 1);
+	memcpy(p, uid_freq_table, uid_state_num * sizeof(u32));
+	p += uid_state_num * sizeof(u32);
+
+	/*
+	 * tasklist_lock keeps release_task() from moving a thread's wakeups
+	 * from live to dead_wakeups until we have read both.  A uid without
+	 * an entry yet has not been charged a tick; its wakeups show up once
+	 * it has one.
+	 */
+	read_lock(&tasklist_lock);
+	rcu_read_lock();
+	for (i = 0; i < ARRAY_SIZE(uid_hash_table); i++)
+		hlist_for_each_entry_rcu(entry, node, &uid_hash_table[i], hash)
+			entry->live_wakeups = 0;
+
+	do_each_thread(g, t) {
+		entry = find_uid_entry(task_uid(t));
+		if (entry)
+			entry->live_wakeups += t->nvcsw;
+	} while_each_thread(g, t);
+	rcu_read_unlock();
+
+	nr = 0;
+	spin_lock_irqsave(&uid_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(uid_hash_table); i++) {
+		hlist_for_each_entry(entry, node, &uid_hash_table[i], hash) {
+			struct uid_time_in_state_record *rec = (void *)p;
+			u64 *time = (u64 *)(rec + 1);
+
+			if (nr == max_nr)
+				break;
+			rec->uid = entry->uid;
+			rec->reserved = 0;
+			rec->wakeups = entry->dead_wakeups +
+				       entry->live_wakeups;
+			for (j = 0; j < uid_state_num; j++)
+				time[j] = cputime64_to_clock_t(
+						entry->time_in_state[j]);
+			p += rec_size;
+			nr++;
+		}
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
+	read_unlock(&tasklist_lock);
+	mutex_unlock(&uid_read_mutex);
+
+	hdr->nr_uids = nr;
+	buf->len = p - buf->data;
+	file->private_data = buf;
+	return 0;
+}
+
+static ssize_t uid_time_in_state_read(struct file *file, char __user *ubuf,
+				      size_t count, loff_t *ppos)
+{
+	struct uid_time_in_state_buf *buf = file->private_data;
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf->data,
+				       buf->len);
+}
+
+static int uid_time_in_state_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations uid_time_in_state_fops = {
+	.open		= uid_time_in_state_open,
+	.read		= uid_time_in_state_read,
+	.llseek		= default_llseek,
+	.release	= uid_time_in_state_release,
+};
+
+static void cpufreq_stats_uid_init_table(struct cpufreq_stats *stat)
+{
+	unsigned int *table;
+
+	if (uid_state_num)
+		return;
+	table = kmemdup(stat->freq_table, stat->state_num * sizeof(u32),
+			GFP_KERNEL);
+	if (!table)
+		return;
+	uid_freq_table = table;
+	smp_wmb();
+	uid_state_num = stat->state_num;
+}
+
+static int __init cpufreq_stats_uid_init(void)
+{
+	if (!proc_create("uid_time_in_state", S_IRUGO, NULL,
+			 &uid_time_in_state_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(cpufreq_stats_uid_init);
+#else
+static inline void cpufreq_stats_uid_init_table(struct cpufreq_stats *stat) {}
+static inline void cpufreq_stats_uid_set_freq(unsigned int cpu,
+					      unsigned int freq) {}
+static inline void cpufreq_stats_uid_clear_freq(unsigned int cpu) {}
+#endif /* CONFIG_CPU_FREQ_STAT_UID */
+
 static int freq_table_get_index(struct cpufreq_stats *stat, unsigned int freq)
 {
 	int index;
@@ -168,6 +483,7 @@ static void cpufreq_stats_free_table(unsigned int cpu)
 {
 	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, cpu);
 	struct cpufreq_policy *policy = cpufreq_cpu_get(cpu);
+	cpufreq_stats_uid_clear_freq(cpu);
 	if (policy && policy->cpu == cpu)
 		sysfs_remove_group(&policy->kobj, &stats_attr_group);
 	if (stat) {
@@ -238,10 +554,12 @@ static int cpufreq_stats_create_table(struct cpufreq_policy *policy,
 			stat->freq_table[j++] = freq;
 	}
 	stat->state_num = j;
+	cpufreq_stats_uid_init_table(stat);
 	spin_lock(&cpufreq_stats_lock);
 	stat->last_time = get_jiffies_64();
 	stat->last_index = freq_table_get_index(stat, policy->cur);
 	spin_unlock(&cpufreq_stats_lock);
+	cpufreq_stats_uid_set_freq(cpu, policy->cur);
 	cpufreq_cpu_put(data);
 	return 0;
 error_out:
@@ -301,6 +619,7 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 #endif
 	stat->total_trans++;
 	spin_unlock(&cpufreq_stats_lock);
+	cpufreq_stats_uid_set_freq(freq->cpu, freq->new);
 	return 0;
 }
 
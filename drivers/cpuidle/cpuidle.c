@@ -42,6 +42,33 @@ static void cpuidle_kick_cpus(void) {}
 
 static int __cpuidle_register_device(struct cpuidle_device *dev);
 
+/**
+ * cpuidle_account_prediction - judge the governor's choice of state
+ * @dev: the CPU's idle device
+ * @idx: the state that was entered
+ *
+ * Compares the residency actually measured against the state's target
+ * residency and the next one's. Not done when the driver demoted the
+ * request to another state.
+ */
+static void cpuidle_account_prediction(struct cpuidle_device *dev, int idx)
+{
+	struct cpuidle_state *s = &dev->states[idx];
+	struct cpuidle_state *next = &dev->states[idx + 1];
+	unsigned int residency = dev->last_residency;
+
+	if (!(s->flags & CPUIDLE_FLAG_TIME_VALID))
+		return;
+
+	if (idx > 0 && residency < s->target_residency)
+		s->too_deep++;
+	else if (idx + 1 < dev->state_count &&
+		 residency >= next->target_residency &&
+		 next->exit_latency <=
+		 pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY))
+		s->too_shallow++;
+}
+
 /**
  * cpuidle_idle_call - the main idle loop
  *
@@ -91,6 +118,8 @@ static void cpuidle_idle_call(void)
 
 	target_state->time += (unsigned long long)dev->last_residency;
 	target_state->usage++;
+	if (target_state == &dev->states[next_state])
+		cpuidle_account_prediction(dev, next_state);
 
 	/* give the governor an opportunity to reflect on the outcome */
 	if (cpuidle_curr_governor->reflect)
@@ -177,6 +206,8 @@ int cpuidle_enable_device(struct cpuidle_device *dev)
 	for (i = 0; i < dev->state_count; i++) {
 		dev->states[i].usage = 0;
 		dev->states[i].time = 0;
+		dev->states[i].too_deep = 0;
+		dev->states[i].too_shallow = 0;
 	}
 	dev->last_residency = 0;
 	dev->last_state = NULL;
@@ -0,0 +1,255 @@
+/*
+ * predict.c - the predictive idle governor
+ *
+ * This code is licenced under the GPL version 2 as described
+ * in the COPYING file that acompanies the Linux Kernel.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos_params.h>
+#include <linux/time.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+
+#define INTERVALS 8
+#define BUCKETS 6
+#define RESOLUTION 1024
+#define DECAY 4
+#define MAX_INTERESTING 50000
+
+/*
+ * The predict governor is meant for platforms with few, widely spaced idle
+ * states, where entering the deep one costs a register save/restore and
+ * some device polling that only pay off for long idles.
+ *
+ * Two predictions are made and the smaller one is used:
+ *
+ * 1) The next timer expiry, scaled by how long the last idles with a
+ *    similar timer distance actually lasted (a correction factor per
+ *    order of magnitude, as the menu governor does).  This catches
+ *    wakeups from interrupts that are not timers.
+ *
+ * 2) The typical length of the last INTERVALS idles, if they are
+ *    consistent enough: the standard deviation must be small compared to
+ *    the average, after dropping up to a quarter of the samples as
+ *    outliers.  This catches periodic wakeups, such as audio DMA, that the
+ *    timer does not know about.
+ *
+ * The deepest state whose target residency is within the prediction and
+ * whose exit latency satisfies PM_QOS_CPU_DMA_LATENCY is chosen.  How often
+ * that was wrong is counted by the cpuidle core in the too_deep and
+ * too_shallow attributes of each state.
+ */
+
+struct predict_device {
+	int		last_state_idx;
+
+	unsigned int	expected_us;
+	unsigned int	bucket;
+	u64		correction_factor[BUCKETS];
+
+	unsigned int	intervals[INTERVALS];
+	int		interval_ptr;
+};
+
+static DEFINE_PER_CPU(struct predict_device, predict_devices);
+
+static inline int which_bucket(unsigned int duration)
+{
+	if (duration < 10)
+		return 0;
+	if (duration < 100)
+		return 1;
+	if (duration < 1000)
+		return 2;
+	if (duration < 10000)
+		return 3;
+	if (duration < 100000)
+		return 4;
+	return 5;
+}
+
+/*
+ * Return the average of the recent idle intervals if they form a stable
+ * pattern, 0 otherwise.
+ */
+static unsigned int predict_typical_interval(struct predict_device *data)
+{
+	unsigned int thresh = UINT_MAX;
+	unsigned int max, avg;
+	u64 sum, variance;
+	int i, count;
+
+again:
+	max = 0;
+	sum = 0;
+	count = 0;
+	for (i = 0; i < INTERVALS; i++) {
+		unsigned int value = data->intervals[i];
+
+		if (value <= thresh) {
+			sum += value;
+			count++;
+			if (value > max)
+				max = value;
+		}
+	}
+	avg = div_u64(sum, count);
+
+	variance = 0;
+	for (i = 0; i < INTERVALS; i++) {
+		unsigned int value = data->intervals[i];
+
+		if (value <= thresh) {
+			s64 diff = (s64)value - avg;
+
+			variance += diff * diff;
+		}
+	}
+	variance = div_u64(variance, count);
+
+	/*
+	 * Accept a standard deviation of up to 20us, or of up to a sixth of
+	 * the average.
+	 */
+	if (variance <= 400 || (u64)avg * avg > 36 * variance)
+		return avg;
+
+	/* drop the largest sample and retry, keeping at least 3/4 of them */
+	if (count * 4 <= INTERVALS * 3)
+		return 0;
+	thresh = max - 1;
+	goto again;
+}
+
+/**
+ * predict_select - selects the next idle state to enter
+ * @dev: the CPU
+ */
+static int predict_select(struct cpuidle_device *dev)
+{
+	struct predict_device *data = &__get_cpu_var(predict_devices);
+	int latency_req = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
+	unsigned int predicted_us, typical_us;
+	int i;
+
+	data->last_state_idx = 0;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	/* determine the expected residency time, round up */
+	data->expected_us =
+	    DIV_ROUND_UP((u32)ktime_to_ns(tick_nohz_get_sleep_length()), 1000);
+
+	data->bucket = which_bucket(data->expected_us);
+
+	/* start out with a unity factor */
+	if (data->correction_factor[data->bucket] == 0)
+		data->correction_factor[data->bucket] = RESOLUTION * DECAY;
+
+	predicted_us = div_u64((u64)data->expected_us *
+			       data->correction_factor[data->bucket],
+			       RESOLUTION * DECAY);
+
+	typical_us = predict_typical_interval(data);
+	if (typical_us && typical_us < predicted_us)
+		predicted_us = typical_us;
+
+	/* find the deepest idle state that satisfies our constraints */
+	for (i = CPUIDLE_DRIVER_STATE_START; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->target_residency > predicted_us)
+			break;
+		if (s->exit_latency > latency_req)
+			break;
+		data->last_state_idx = i;
+	}
+
+	return data->last_state_idx;
+}
+
+/**
+ * predict_reflect - records the actual idle period and updates the predictors
+ * @dev: the CPU
+ */
+static void predict_reflect(struct cpuidle_device *dev)
+{
+	struct predict_device *data = &__get_cpu_var(predict_devices);
+	struct cpuidle_state *target = dev->last_state;
+	unsigned int measured_us = cpuidle_get_last_residency(dev);
+	u64 new_factor;
+
+	if (!target)
+		target = &dev->states[data->last_state_idx];
+
+	/* no residency measurement: assume we slept for the expected time */
+	if (unlikely(!(target->flags & CPUIDLE_FLAG_TIME_VALID)))
+		measured_us = data->expected_us;
+
+	/* the exit latency happens after the event we're interested in */
+	if (measured_us > target->exit_latency)
+		measured_us -= target->exit_latency;
+
+	new_factor = data->correction_factor[data->bucket]
+			* (DECAY - 1) / DECAY;
+	if (data->expected_us > 0 && measured_us < MAX_INTERESTING)
+		new_factor += RESOLUTION * measured_us / data->expected_us;
+	else
+		new_factor += RESOLUTION;
+	if (new_factor == 0)
+		new_factor = 1;
+	data->correction_factor[data->bucket] = new_factor;
+
+	data->intervals[data->interval_ptr++] = measured_us;
+	if (data->interval_ptr >= INTERVALS)
+		data->interval_ptr = 0;
+}
+
+/**
+ * predict_enable_device - scans a CPU's states and does setup
+ * @dev: the CPU
+ */
+static int predict_enable_device(struct cpuidle_device *dev)
+{
+	struct predict_device *data = &per_cpu(predict_devices, dev->cpu);
+
+	memset(data, 0, sizeof(struct predict_device));
+
+	return 0;
+}
+
+static struct cpuidle_governor predict_governor = {
+	.name =		"predict",
+	.rating =	30,
+	.enable =	predict_enable_device,
+	.select =	predict_select,
+	.reflect =	predict_reflect,
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * init_predict - initializes the governor
+ */
+static int __init init_predict(void)
+{
+	return cpuidle_register_governor(&predict_governor);
+}
+
+/**
+ * exit_predict - exits the governor
+ */
+static void __exit exit_predict(void)
+{
+	cpuidle_unregister_governor(&predict_governor);
+}
+
+MODULE_LICENSE("GPL");
+module_init(init_predict);
+module_exit(exit_predict);
@@ -241,6 +241,8 @@ define_show_state_function(exit_latency)
 define_show_state_function(power_usage)
 define_show_state_ull_function(usage)
 define_show_state_ull_function(time)
+define_show_state_ull_function(too_deep)
+define_show_state_ull_function(too_shallow)
 define_show_state_str_function(name)
 define_show_state_str_function(desc)
 
@@ -250,6 +252,8 @@ define_one_state_ro(latency, show_state_exit_latency);
 define_one_state_ro(power, show_state_power_usage);
 define_one_state_ro(usage, show_state_usage);
 define_one_state_ro(time, show_state_time);
+define_one_state_ro(too_deep, show_state_too_deep);
+define_one_state_ro(too_shallow, show_state_too_shallow);
 
 static struct attribute *cpuidle_state_default_attrs[] = {
 	&attr_name.attr,
@@ -258,6 +262,8 @@ static struct attribute *cpuidle_state_default_attrs[] = {
 	&attr_power.attr,
 	&attr_usage.attr,
 	&attr_time.attr,
+	&attr_too_deep.attr,
+	&attr_too_shallow.attr,
 	NULL
 };
 
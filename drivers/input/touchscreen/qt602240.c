@@ -3596,6 +3596,8 @@ int qt602240_probe(struct i2c_client *client,
 	//	enable_irq(qt602240->client->irq);
 #ifdef USE_TSP_EARLY_SUSPEND
 	qt602240->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
+	/* only talks to the touch chip, so it can overlap the backlight */
+	qt602240->early_suspend.flags = EARLY_SUSPEND_ASYNC;
 	qt602240->early_suspend.suspend = qt602240_early_suspend;
 	qt602240->early_suspend.resume = qt602240_late_resume;
 	register_early_suspend(&qt602240->early_suspend);
@@ -2414,6 +2414,8 @@ static int __devinit s3c_bat_probe(struct platform_device *pdev)
 	if (s3c_bat_info.polling)
 	{
 		setup_timer(&polling_timer, polling_timer_func, 0);
+		/* let the poll share a wakeup with other timers */
+		set_timer_slack(&polling_timer, HZ / 2);
 		mod_timer(&polling_timer, jiffies + msecs_to_jiffies(s3c_bat_info.polling_interval));
 	}
 
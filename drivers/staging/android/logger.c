@@ -24,9 +24,15 @@
 #include <linux/uaccess.h>
 #include <linux/poll.h>
 #include <linux/time.h>
+#include <linux/spinlock.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/lzo.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
+#include <asm/io.h>
 
 /*
  *  Mark for GetLog (tkhwang)
@@ -82,36 +88,69 @@ static struct struct_marks_ver_mark marks_ver_mark = {
 	.second_start_addr=0x40000000
 };
 
-static char klog_buf[256];
-
 /*
  * struct logger_log - represents a specific log, such as 'main' or 'radio'
  *
  * This structure lives from module insertion until module removal, so it does
- * not need additional reference counting. The structure is protected by the
- * mutex 'mutex'.
+ * not need additional reference counting.
+ *
+ * Writers never sleep on a lock. A write reserves its bytes and stores the
+ * entry header under the spinlock 'lock', copies the payload in without any
+ * lock held, and then commits. Reservations are queued on 'pending' in ring
+ * order, and a commit moves 'w_off' over every committed reservation at the
+ * front of the queue, so readers, which never look past 'w_off', only ever
+ * see complete entries and see them as soon as everything before them is
+ * complete. A reservation never reaches back to 'w_off', the start of the
+ * oldest uncommitted entry; a writer that would have to waits on 'w_wq'.
+ * 'lock' protects the offsets, 'pending' and the readers list; 'mutex' only
+ * serializes readers against each other.
  */
 struct logger_log {
 	unsigned char 		*buffer;/* the ring buffer itself */
 	struct miscdevice	misc;	/* misc device representing the log */
 	wait_queue_head_t	wq;	/* wait queue for readers */
 	struct list_head	readers; /* this log's readers */
-	struct mutex		mutex;	/* mutex protecting buffer */
-	size_t			w_off;	/* current write head offset */
+	struct mutex		mutex;	/* mutex serializing readers */
+	spinlock_t		lock;	/* lock protecting offsets and readers */
+	size_t			w_off;	/* committed write head offset */
+	size_t			w_reserve; /* reserved write head offset */
+	size_t			w_inflight; /* bytes from w_off to w_reserve */
+	struct list_head	pending; /* uncommitted reservations, in order */
+	wait_queue_head_t	w_wq;	/* writers waiting for ring space */
 	size_t			head;	/* new readers start here */
 	size_t			size;	/* size of the log */
+	u32			w_count; /* bytes committed since boot */
+	u32			w_reserve_count; /* bytes reserved since boot */
+	u32			head_count; /* 'head' as a byte position */
+	struct logger_mmap_header *mmap_hdr; /* page published to mmap() */
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+	struct list_head	chunks;	/* sealed history, oldest first */
+	unsigned long		chunk_next_id; /* id of the next sealed chunk */
+	size_t			archive_size; /* bytes held by 'chunks' */
+	size_t			seal_off; /* ring offset sealing resumes at */
+	struct work_struct	seal_work; /* seals the ring into 'chunks' */
+#endif
 };
 
 /*
  * struct logger_reader - a logging device open for reading
  *
  * This object lives from open to release, so we don't need additional
- * reference counting. The structure is protected by log->mutex.
+ * reference counting. r_off is protected by log->lock.
  */
 struct logger_reader {
 	struct logger_log	*log;	/* associated log */
 	struct list_head	list;	/* entry in logger_log's list */
 	size_t			r_off;	/* current read head offset */
+	int			batch;	/* read() returns as many as fit */
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+	int			in_archive; /* reading sealed chunks, not ring */
+	unsigned long		chunk_id; /* chunk being read */
+	size_t			c_off;	/* offset into the unpacked chunk */
+	unsigned char		*cbuf;	/* unpacked copy of chunk 'cbuf_id' */
+	unsigned long		cbuf_id;
+	size_t			cbuf_len;
+#endif
 };
 
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
@@ -144,7 +183,7 @@ static inline struct logger_log *file_get_log(struct file *file)
  * get_entry_len - Grabs the length of the payload of the next entry starting
  * from 'off'.
  *
- * Caller needs to hold log->mutex.
+ * Caller needs to hold log->lock.
  */
 static __u32 get_entry_len(struct logger_log *log, size_t off)
 {
@@ -163,13 +202,14 @@ static __u32 get_entry_len(struct logger_log *log, size_t off)
 }
 
 /*
- * do_read_log_to_user - reads exactly 'count' bytes from 'log' into the
- * user-space buffer 'buf'. Returns 'count' on success.
+ * do_read_log_to_user - reads exactly 'count' bytes from 'log' at 'off' into
+ * the user-space buffer 'buf'. Returns 'count' on success.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->mutex, but not log->lock: writers may overwrite the
+ * entry while it is being copied, so the caller has to check afterwards that
+ * the reader was not lapped.
  */
-static ssize_t do_read_log_to_user(struct logger_log *log,
-				   struct logger_reader *reader,
+static ssize_t do_read_log_to_user(struct logger_log *log, size_t off,
 				   char __user *buf,
 				   size_t count)
 {
@@ -180,8 +220,8 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 	 * the current read head offset up to 'count' bytes or to the end of
 	 * the log, whichever comes first.
 	 */
-	len = min(count, log->size - reader->r_off);
-	if (copy_to_user(buf, log->buffer + reader->r_off, len))
+	len = min(count, log->size - off);
+	if (copy_to_user(buf, log->buffer + off, len))
 		return -EFAULT;
 
 	/*
@@ -192,11 +232,419 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
 		if (copy_to_user(buf + len, log->buffer, count - len))
 			return -EFAULT;
 
-	reader->r_off = logger_offset(reader->r_off + count);
-
 	return count;
 }
 
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+
+/*
+ * Sealed history. Once LOGGER_CHUNK_SIZE bytes of committed entries have
+ * built up behind seal_off, the seal worker copies whole entries out of the
+ * ring, compresses them with LZO and appends them to log->chunks, dropping
+ * the oldest chunks beyond archive_ratio times the ring size. Readers that
+ * start in the archive walk the chunks in order and then continue in the
+ * ring at seal_off, which is exactly where the newest chunk ends. The chunk
+ * list and the readers' archive state are protected by log->mutex.
+ *
+ * A log costs its ring plus up to archive_ratio rings of packed chunks. The
+ * rings are halved with the archive on, so at the default ratio a log takes
+ * no more memory than its plain ring did, while the archive holds as many
+ * rings' worth of history as log text compresses.
+ */
+#define LOGGER_CHUNK_SIZE	(16*1024)
+
+struct logger_chunk {
+	struct list_head	list;
+	unsigned long		id;
+	size_t			len;	/* unpacked length */
+	size_t			clen;	/* packed length */
+	unsigned char		data[0];
+};
+
+static unsigned int archive_ratio = 1;
+module_param(archive_ratio, uint, S_IRUGO | S_IWUSR);
+
+/* the seal worker's scratch space, shared by all logs */
+static DEFINE_MUTEX(logger_seal_mutex);
+static unsigned char *logger_seal_buf;
+static unsigned char *logger_seal_cbuf;
+static void *logger_seal_wrkmem;
+
+static void logger_archive_append(struct logger_log *log, size_t len)
+{
+	struct logger_chunk *chunk;
+	size_t clen;
+	int ret;
+
+	ret = lzo1x_1_compress(logger_seal_buf, len, logger_seal_cbuf, &clen,
+			       logger_seal_wrkmem);
+	if (ret != LZO_E_OK)
+		return;
+
+	chunk = kmalloc(sizeof(*chunk) + clen, GFP_KERNEL);
+	if (!chunk)
+		return;
+	chunk->id = log->chunk_next_id++;
+	chunk->len = len;
+	chunk->clen = clen;
+	memcpy(chunk->data, logger_seal_cbuf, clen);
+	list_add_tail(&chunk->list, &log->chunks);
+	log->archive_size += sizeof(*chunk) + clen;
+
+	while (log->archive_size > archive_ratio * log->size) {
+		chunk = list_first_entry(&log->chunks, struct logger_chunk,
+					 list);
+		list_del(&chunk->list);
+		log->archive_size -= sizeof(*chunk) + chunk->clen;
+		kfree(chunk);
+	}
+}
+
+static void logger_seal_work(struct work_struct *work)
+{
+	struct logger_log *log = container_of(work, struct logger_log,
+					      seal_work);
+	size_t start, off, len, n;
+
+	if (!logger_seal_buf)
+		return;
+
+	mutex_lock(&logger_seal_mutex);
+	mutex_lock(&log->mutex);
+	while (1) {
+		spin_lock(&log->lock);
+		if (logger_offset(log->w_off - log->seal_off) <
+		    LOGGER_CHUNK_SIZE) {
+			spin_unlock(&log->lock);
+			break;
+		}
+		/* whole entries only, the first one always fits */
+		start = off = log->seal_off;
+		len = 0;
+		do {
+			n = get_entry_len(log, off);
+			len += n;
+			off = logger_offset(off + n);
+		} while (len + get_entry_len(log, off) <= LOGGER_CHUNK_SIZE);
+		spin_unlock(&log->lock);
+
+		n = min(len, log->size - start);
+		memcpy(logger_seal_buf, log->buffer + start, n);
+		if (n != len)
+			memcpy(logger_seal_buf + n, log->buffer, len - n);
+
+		/* lapped by a writer during the copy: the copy may be torn */
+		spin_lock(&log->lock);
+		if (log->seal_off != start) {
+			spin_unlock(&log->lock);
+			continue;
+		}
+		log->seal_off = off;
+		spin_unlock(&log->lock);
+
+		logger_archive_append(log, len);
+	}
+	mutex_unlock(&log->mutex);
+	mutex_unlock(&logger_seal_mutex);
+}
+
+/*
+ * logger_seal_due - is a chunk's worth committed behind seal_off?
+ *
+ * The caller needs to hold log->lock.
+ */
+static inline int logger_seal_due(struct logger_log *log)
+{
+	return logger_seal_buf &&
+	       logger_offset(log->w_off - log->seal_off) >= LOGGER_CHUNK_SIZE;
+}
+
+static inline void logger_seal_schedule(struct logger_log *log)
+{
+	schedule_work(&log->seal_work);
+}
+
+static inline int logger_reader_in_archive(struct logger_reader *reader)
+{
+	return reader->in_archive;
+}
+
+/*
+ * logger_reader_start - position a new reader at the oldest sealed chunk,
+ * or at the ring's head if there is none.
+ *
+ * The caller needs to hold log->mutex and log->lock.
+ */
+static void logger_reader_start(struct logger_log *log,
+				struct logger_reader *reader)
+{
+	reader->cbuf = NULL;
+	reader->cbuf_len = 0;
+	reader->c_off = 0;
+	reader->in_archive = !list_empty(&log->chunks);
+	if (reader->in_archive) {
+		reader->chunk_id = list_first_entry(&log->chunks,
+					struct logger_chunk, list)->id;
+		reader->cbuf_id = reader->chunk_id - 1;
+	}
+	reader->r_off = log->head;
+}
+
+/*
+ * logger_archive_next - unpack the chunk the reader is in, or move the reader
+ * on to the ring once it is past the newest chunk.
+ *
+ * Returns the reader's chunk, or NULL if it has moved to the ring. The caller
+ * needs to hold log->mutex.
+ */
+static struct logger_chunk *logger_archive_next(struct logger_log *log,
+						struct logger_reader *reader)
+{
+	struct logger_chunk *chunk;
+	size_t len;
+
+	list_for_each_entry(chunk, &log->chunks, list) {
+		if (chunk->id - reader->chunk_id >= LONG_MAX)
+			continue;	/* older than the reader */
+		if (chunk->id != reader->chunk_id) {
+			/* our chunk was dropped, skip ahead */
+			reader->chunk_id = chunk->id;
+			reader->c_off = 0;
+		}
+		if (reader->cbuf && reader->cbuf_id == chunk->id)
+			return chunk;
+		if (!reader->cbuf) {
+			reader->cbuf = vmalloc(LOGGER_CHUNK_SIZE);
+			if (!reader->cbuf)
+				return ERR_PTR(-ENOMEM);
+		}
+		len = LOGGER_CHUNK_SIZE;
+		if (lzo1x_decompress_safe(chunk->data, chunk->clen,
+					  reader->cbuf, &len) != LZO_E_OK ||
+		    len != chunk->len) {
+			/* should not happen; lose the chunk, not the reader */
+			reader->chunk_id++;
+			reader->c_off = 0;
+			continue;
+		}
+		reader->cbuf_id = chunk->id;
+		reader->cbuf_len = len;
+		return chunk;
+	}
+
+	spin_lock(&log->lock);
+	reader->in_archive = 0;
+	reader->r_off = log->seal_off;
+	spin_unlock(&log->lock);
+	return NULL;
+}
+
+/*
+ * logger_read_archive - read one entry, or in batch mode as many as fit,
+ * from the sealed history
+ *
+ * Returns the number of bytes read, 0 if the reader has moved on to the ring,
+ * or a negative error code. The caller needs to hold log->mutex.
+ */
+static ssize_t logger_read_archive(struct logger_log *log,
+				   struct logger_reader *reader,
+				   char __user *buf, size_t count)
+{
+	struct logger_chunk *chunk;
+	ssize_t ret = 0;
+	__u16 val;
+	size_t len;
+
+	do {
+		chunk = logger_archive_next(log, reader);
+		if (!chunk || IS_ERR(chunk))
+			return ret ? ret : PTR_ERR(chunk);
+
+		memcpy(&val, reader->cbuf + reader->c_off, sizeof(val));
+		len = sizeof(struct logger_entry) + val;
+		if (count - ret < len)
+			return ret ? ret : -EINVAL;
+		if (copy_to_user(buf + ret, reader->cbuf + reader->c_off, len))
+			return -EFAULT;
+
+		reader->c_off += len;
+		if (reader->c_off >= reader->cbuf_len) {
+			reader->chunk_id++;
+			reader->c_off = 0;
+		}
+		ret += len;
+	} while (reader->batch);
+
+	return ret;
+}
+
+/*
+ * logger_archive_entry_len - size of the reader's next sealed entry, or 0 if
+ * the reader has moved on to the ring. The caller needs to hold log->mutex.
+ */
+static long logger_archive_entry_len(struct logger_log *log,
+				     struct logger_reader *reader)
+{
+	struct logger_chunk *chunk;
+	__u16 val;
+
+	chunk = logger_archive_next(log, reader);
+	if (!chunk || IS_ERR(chunk))
+		return PTR_ERR(chunk);
+
+	memcpy(&val, reader->cbuf + reader->c_off, sizeof(val));
+	return sizeof(struct logger_entry) + val;
+}
+
+/*
+ * logger_reader_ring_off - where the reader will be reading in the ring
+ *
+ * The caller needs to hold log->lock.
+ */
+static inline size_t logger_reader_ring_off(struct logger_log *log,
+					    struct logger_reader *reader)
+{
+	return reader->in_archive ? log->seal_off : reader->r_off;
+}
+
+/*
+ * logger_archive_len - bytes left in the sealed history for this reader,
+ * not counting the ring. The caller needs to hold log->mutex.
+ */
+static size_t logger_archive_len(struct logger_log *log,
+				 struct logger_reader *reader)
+{
+	struct logger_chunk *chunk;
+	size_t len = 0;
+
+	if (!reader->in_archive)
+		return 0;
+	list_for_each_entry(chunk, &log->chunks, list) {
+		if (chunk->id - reader->chunk_id >= LONG_MAX)
+			continue;
+		len += chunk->len;
+		if (chunk->id == reader->chunk_id)
+			len -= reader->c_off;
+	}
+	return len;
+}
+
+/*
+ * logger_archive_flush - drop the sealed history
+ *
+ * The caller needs to hold log->mutex and log->lock.
+ */
+static void logger_archive_flush(struct logger_log *log)
+{
+	struct logger_chunk *chunk, *tmp;
+	struct logger_reader *reader;
+
+	list_for_each_entry_safe(chunk, tmp, &log->chunks, list) {
+		list_del(&chunk->list);
+		kfree(chunk);
+	}
+	log->archive_size = 0;
+	log->seal_off = log->w_off;
+	list_for_each_entry(reader, &log->readers, list)
+		reader->in_archive = 0;
+}
+
+static void logger_reader_free(struct logger_reader *reader)
+{
+	vfree(reader->cbuf);
+}
+
+static int __init logger_archive_init(void)
+{
+	logger_seal_buf = vmalloc(LOGGER_CHUNK_SIZE);
+	logger_seal_cbuf = vmalloc(lzo1x_worst_compress(LOGGER_CHUNK_SIZE));
+	logger_seal_wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	if (!logger_seal_buf || !logger_seal_cbuf || !logger_seal_wrkmem) {
+		vfree(logger_seal_buf);
+		vfree(logger_seal_cbuf);
+		vfree(logger_seal_wrkmem);
+		logger_seal_buf = NULL;
+		printk(KERN_ERR "logger: no memory for compressed history\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+#define LOGGER_ARCHIVE_INIT(VAR) \
+	.chunks = LIST_HEAD_INIT(VAR .chunks), \
+	.chunk_next_id = 0, \
+	.archive_size = 0, \
+	.seal_off = 0, \
+	.seal_work = __WORK_INITIALIZER(VAR .seal_work, logger_seal_work),
+
+#define LOGGER_RING_SIZE(SIZE)	((SIZE) / 2)
+
+#else
+
+static inline int logger_seal_due(struct logger_log *log)
+{
+	return 0;
+}
+
+static inline void logger_seal_schedule(struct logger_log *log)
+{
+}
+
+static inline int logger_reader_in_archive(struct logger_reader *reader)
+{
+	return 0;
+}
+
+static inline void logger_reader_start(struct logger_log *log,
+				       struct logger_reader *reader)
+{
+	reader->r_off = log->head;
+}
+
+static inline ssize_t logger_read_archive(struct logger_log *log,
+					  struct logger_reader *reader,
+					  char __user *buf, size_t count)
+{
+	return 0;
+}
+
+static inline long logger_archive_entry_len(struct logger_log *log,
+					    struct logger_reader *reader)
+{
+	return 0;
+}
+
+static inline size_t logger_reader_ring_off(struct logger_log *log,
+					    struct logger_reader *reader)
+{
+	return reader->r_off;
+}
+
+static inline size_t logger_archive_len(struct logger_log *log,
+					struct logger_reader *reader)
+{
+	return 0;
+}
+
+static inline void logger_archive_flush(struct logger_log *log)
+{
+}
+
+static inline void logger_reader_free(struct logger_reader *reader)
+{
+}
+
+static inline int logger_archive_init(void)
+{
+	return 0;
+}
+
+#define LOGGER_ARCHIVE_INIT(VAR)
+
+#define LOGGER_RING_SIZE(SIZE)	(SIZE)
+
+#endif /* CONFIG_ANDROID_LOGGER_COMPRESS */
+
 /*
  * logger_read - our log's read() method
  *
@@ -204,7 +652,8 @@ static ssize_t do_read_log_to_user(struct logger_log *log,
  *
  * 	- O_NONBLOCK works
  * 	- If there are no log entries to read, blocks until log is written to
- * 	- Atomically reads exactly one log entry
+ * 	- Atomically reads exactly one log entry, or after LOGGER_SET_BATCH_READ
+ * 	  as many complete entries as fit in the buffer
  *
  * Optimal read size is LOGGER_ENTRY_MAX_LEN. Will set errno to EINVAL if read
  * buffer is insufficient to hold next entry.
@@ -214,6 +663,7 @@ static ssize_t logger_read(struct file *file, char __user *buf,
 {
 	struct logger_reader *reader = file->private_data;
 	struct logger_log *log = reader->log;
+	size_t off;
 	ssize_t ret;
 	DEFINE_WAIT(wait);
 
@@ -221,9 +671,10 @@ start:
 	while (1) {
 		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
 
-		mutex_lock(&log->mutex);
-		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
+		spin_lock(&log->lock);
+		ret = !logger_reader_in_archive(reader) &&
+		      (log->w_off == reader->r_off);
+		spin_unlock(&log->lock);
 		if (!ret)
 			break;
 
@@ -246,21 +697,61 @@ start:
 
 	mutex_lock(&log->mutex);
 
+	/* sealed history comes first, then the ring */
+	if (logger_reader_in_archive(reader)) {
+		ret = logger_read_archive(log, reader, buf, count);
+		if (ret)
+			goto out;
+	}
+
+	spin_lock(&log->lock);
+
 	/* is there still something to read or did we race? */
 	if (unlikely(log->w_off == reader->r_off)) {
+		spin_unlock(&log->lock);
 		mutex_unlock(&log->mutex);
 		goto start;
 	}
 
 	/* get the size of the next entry */
-	ret = get_entry_len(log, reader->r_off);
+	off = reader->r_off;
+	ret = get_entry_len(log, off);
+	if (reader->batch && ret <= count) {
+		/* and of any further whole entries that fit */
+		size_t end = logger_offset(off + ret);
+
+		while (end != log->w_off) {
+			size_t len = get_entry_len(log, end);
+
+			if (ret + len > count)
+				break;
+			ret += len;
+			end = logger_offset(end + len);
+		}
+	}
+	spin_unlock(&log->lock);
 	if (count < ret) {
 		ret = -EINVAL;
 		goto out;
 	}
 
-	/* get exactly one entry from the log */
-	ret = do_read_log_to_user(log, reader, buf, ret);
+	/* get exactly one entry, or a batch of them, from the log */
+	ret = do_read_log_to_user(log, off, buf, ret);
+	if (ret < 0)
+		goto out;
+
+	/*
+	 * A writer that lapped us while we copied has pulled r_off forward
+	 * and the entry we copied may be torn; retry from the new offset.
+	 */
+	spin_lock(&log->lock);
+	if (unlikely(reader->r_off != off)) {
+		spin_unlock(&log->lock);
+		mutex_unlock(&log->mutex);
+		goto start;
+	}
+	reader->r_off = logger_offset(off + ret);
+	spin_unlock(&log->lock);
 
 out:
 	mutex_unlock(&log->mutex);
@@ -272,7 +763,7 @@ out:
  * get_next_entry - return the offset of the first valid entry at least 'len'
  * bytes after 'off'.
  *
- * Caller must hold log->mutex.
+ * Caller must hold log->lock.
  */
 static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
 {
@@ -308,18 +799,29 @@ static inline int clock_interval(size_t a, size_t b, size_t c)
  * fix_up_readers - walk the list of all readers and "fix up" any who were
  * lapped by the writer; also do the same for the default "start head".
  * We do this by "pulling forward" the readers and start head to the first
- * entry after the new write head.
+ * entry after the new reserved write head. As a reservation never reaches
+ * 'w_off', nobody is pulled past it or into an entry still being written.
  *
- * The caller needs to hold log->mutex.
+ * The caller needs to hold log->lock.
  */
 static void fix_up_readers(struct logger_log *log, size_t len)
 {
-	size_t old = log->w_off;
+	size_t old = log->w_reserve;
 	size_t new = logger_offset(old + len);
 	struct logger_reader *reader;
 
-	if (clock_interval(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
+	if (clock_interval(old, new, log->head)) {
+		size_t head = get_next_entry(log, log->head, len);
+
+		log->head_count += logger_offset(head - log->head);
+		log->head = head;
+	}
+
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+	/* the seal worker fell behind, that part of the history is lost */
+	if (clock_interval(old, new, log->seal_off))
+		log->seal_off = get_next_entry(log, log->seal_off, len);
+#endif
 
 	list_for_each_entry(reader, &log->readers, list)
 		if (clock_interval(old, new, reader->r_off))
@@ -327,39 +829,39 @@ static void fix_up_readers(struct logger_log *log, size_t len)
 }
 
 /*
- * do_write_log - writes 'len' bytes from 'buf' to 'log'
+ * do_write_log - writes 'count' bytes from 'buf' to 'log' at 'off'
  *
- * The caller needs to hold log->mutex.
+ * The caller must own [off, off + count) through a reservation.
  */
-static void do_write_log(struct logger_log *log, const void *buf, size_t count)
+static void do_write_log(struct logger_log *log, size_t off, const void *buf,
+			 size_t count)
 {
 	size_t len;
 
-	len = min(count, log->size - log->w_off);
-	memcpy(log->buffer + log->w_off, buf, len);
+	len = min(count, log->size - off);
+	memcpy(log->buffer + off, buf, len);
 
 	if (count != len)
 		memcpy(log->buffer, buf + len, count - len);
-
-	log->w_off = logger_offset(log->w_off + count);
-
 }
 
 /*
- * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
+ * do_write_log_user - writes 'count' bytes from the user-space buffer 'buf' to
+ * the log 'log' at 'off'
  *
- * The caller needs to hold log->mutex.
+ * The caller must own [off, off + count) through a reservation and must not
+ * hold log->lock, as the copy may fault.
  *
  * Returns 'count' on success, negative error code on failure.
  */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
+static ssize_t do_write_log_from_user(struct logger_log *log, size_t off,
+				      const void __user *buf, size_t count,
+				      char *klog_buf)
 {
 	size_t len;
 
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
+	len = min(count, log->size - off);
+	if (len && copy_from_user(log->buffer + off, buf, len))
 		return -EFAULT;
 
 	if (count != len)
@@ -368,24 +870,145 @@ static ssize_t do_write_log_from_user(struct logger_log *log,
 
 #if 1
 /* [LINUSYS] added by khoonk for calculating boot-time  on 20070508  */
-	memset(klog_buf,0,255);
-
-	if(strncmp(log->buffer  + log->w_off,  "!@", 2) == 0) {
+	if(strncmp(log->buffer + off,  "!@", 2) == 0) {
+		memset(klog_buf,0,255);
 		if (count < 255)
-			memcpy(klog_buf,log->buffer  + log->w_off, count);			
+			memcpy(klog_buf,log->buffer + off, count);
 		else
-			memcpy(klog_buf,log->buffer  + log->w_off, 255);			
+			memcpy(klog_buf,log->buffer + off, 255);
 
 		klog_buf[255]=0;
 }
 /* [LINUSYS] added by khoonk for calculating boot-time  on 20070508  */
 #endif	
 
-	log->w_off = logger_offset(log->w_off + count);
-
 	return count;
 }
 
+/*
+ * logger_publish - update the cursors mmap() readers see
+ *
+ * The caller needs to hold log->lock.
+ */
+static inline void logger_publish(struct logger_log *log)
+{
+	struct logger_mmap_header *hdr = log->mmap_hdr;
+
+	if (!hdr)
+		return;
+	hdr->head_count = log->head_count;
+	hdr->w_reserve_count = log->w_reserve_count;
+	hdr->w_count = log->w_count;
+}
+
+/*
+ * struct logger_reservation - one entry between reserve and commit
+ *
+ * Lives on the writer's stack and is queued on log->pending under log->lock.
+ */
+struct logger_reservation {
+	struct list_head	list;	/* entry in log->pending */
+	size_t			end;	/* ring offset just past the entry */
+	size_t			len;	/* length of the entry */
+	int			done;	/* committed, waiting for its turn */
+};
+
+/* makes writers take log->mutex around each write, as they used to */
+static int serialize_writes;
+module_param(serialize_writes, bool, S_IRUGO | S_IWUSR);
+
+/*
+ * logger_reserve - claims 'len' bytes at the write head for one entry and
+ * stores its header there, so the entry is correctly framed for anyone
+ * walking the log while the payload is still being copied in.
+ *
+ * If the claim would reach the oldest uncommitted entry, which readers may
+ * not be pulled past and which must not be overwritten while its writer is
+ * still copying, we wait for the writers in front of us. That takes a whole
+ * ring's worth of entries in flight, so it only happens on tiny logs.
+ *
+ * Returns the offset of the payload.
+ */
+static size_t logger_reserve(struct logger_log *log,
+			     struct logger_reservation *res,
+			     struct logger_entry *header, size_t len)
+{
+	DEFINE_WAIT(wait);
+	size_t off;
+
+	spin_lock(&log->lock);
+
+	while (unlikely(log->w_inflight + len >= log->size)) {
+		prepare_to_wait(&log->w_wq, &wait, TASK_UNINTERRUPTIBLE);
+		spin_unlock(&log->lock);
+		schedule();
+		spin_lock(&log->lock);
+	}
+	finish_wait(&log->w_wq, &wait);
+
+	/*
+	 * Fix up any readers, pulling them forward to the first readable
+	 * entry after (what will be) the new reserved write offset.
+	 */
+	fix_up_readers(log, len);
+
+	off = log->w_reserve;
+	log->w_reserve = logger_offset(off + len);
+	log->w_reserve_count += len;
+	log->w_inflight += len;
+	res->end = log->w_reserve;
+	res->len = len;
+	res->done = 0;
+	list_add_tail(&res->list, &log->pending);
+	/* mmap readers must see the claim before the bytes change */
+	logger_publish(log);
+	smp_wmb();
+	do_write_log(log, off, header, sizeof(struct logger_entry));
+
+	spin_unlock(&log->lock);
+
+	return logger_offset(off + sizeof(struct logger_entry));
+}
+
+/*
+ * logger_commit - marks a reservation complete and publishes the committed
+ * prefix of log->pending. Reservations are contiguous, so the write head
+ * readers see moves up to the end of the last entry that has no uncommitted
+ * entry in front of it.
+ */
+static void logger_commit(struct logger_log *log,
+			  struct logger_reservation *res)
+{
+	struct logger_reservation *first;
+	int seal, moved = 0;
+
+	spin_lock(&log->lock);
+	res->done = 1;
+	/* entry contents must be visible before the new head */
+	smp_wmb();
+	while (!list_empty(&log->pending)) {
+		first = list_first_entry(&log->pending,
+					 struct logger_reservation, list);
+		if (!first->done)
+			break;
+		log->w_off = first->end;
+		log->w_count += first->len;
+		log->w_inflight -= first->len;
+		list_del(&first->list);
+		moved = 1;
+	}
+	if (moved) {
+		logger_publish(log);
+		if (waitqueue_active(&log->w_wq))
+			wake_up(&log->w_wq);
+	}
+	seal = logger_seal_due(log);
+	spin_unlock(&log->lock);
+
+	if (seal)
+		logger_seal_schedule(log);
+}
+
 /*
  * logger_aio_write - our write method, implementing support for write(),
  * writev(), and aio_write(). Writes are our fast path, and we try to optimize
@@ -395,9 +1018,11 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
+	struct logger_reservation res;
 	struct logger_entry header;
 	struct timespec now;
+	char klog_buf[256];
+	size_t off;
 	ssize_t ret = 0;
 
 	now = current_kernel_time();
@@ -412,17 +1037,11 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
-
-	/*
-	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
-	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
-
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	klog_buf[0] = 0;
+	if (serialize_writes)
+		mutex_lock(&log->mutex);
+	off = logger_reserve(log, &res, &header,
+			     sizeof(struct logger_entry) + header.len);
 
 	while (nr_segs-- > 0) {
 		size_t len;
@@ -432,18 +1051,32 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
 		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
+		nr = do_write_log_from_user(log, off, iov->iov_base, len,
+					    klog_buf);
 		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+			/*
+			 * Later writers may already have reserved past us,
+			 * so the entry cannot be unwound; blank the payload
+			 * instead and commit it.
+			 */
+			len = header.len - ret;
+			if (len > log->size - off) {
+				memset(log->buffer + off, 0, log->size - off);
+				memset(log->buffer, 0, len - (log->size - off));
+			} else
+				memset(log->buffer + off, 0, len);
+			ret = nr;
+			break;
 		}
 
+		off = logger_offset(off + nr);
 		iov++;
 		ret += nr;
 	}
 
-	mutex_unlock(&log->mutex);
+	logger_commit(log, &res);
+	if (serialize_writes)
+		mutex_unlock(&log->mutex);
 
 	/* wake up any blocked readers */
 	wake_up_interruptible(&log->wq);
@@ -488,11 +1121,14 @@ static int logger_open(struct inode *inode, struct file *file)
 			return -ENOMEM;
 
 		reader->log = log;
+		reader->batch = 0;
 		INIT_LIST_HEAD(&reader->list);
 
 		mutex_lock(&log->mutex);
-		reader->r_off = log->head;
+		spin_lock(&log->lock);
+		logger_reader_start(log, reader);
 		list_add_tail(&reader->list, &log->readers);
+		spin_unlock(&log->lock);
 		mutex_unlock(&log->mutex);
 
 		file->private_data = reader;
@@ -511,7 +1147,12 @@ static int logger_release(struct inode *ignored, struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
+		struct logger_log *log = reader->log;
+
+		spin_lock(&log->lock);
 		list_del(&reader->list);
+		spin_unlock(&log->lock);
+		logger_reader_free(reader);
 		kfree(reader);
 	}
 
@@ -541,21 +1182,87 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
-	if (log->w_off != reader->r_off)
+	spin_lock(&log->lock);
+	if (logger_reader_in_archive(reader) || log->w_off != reader->r_off)
 		ret |= POLLIN | POLLRDNORM;
-	mutex_unlock(&log->mutex);
+	spin_unlock(&log->lock);
 
 	return ret;
 }
 
+/*
+ * logger_set_read_pos - move the reader to the byte position 'pos' an mmap()
+ * reader has consumed up to, so that poll() waits for entries after it.
+ * 'pos' must be an entry boundary between the reader and the write head.
+ *
+ * The caller needs to hold log->lock.
+ */
+static long logger_set_read_pos(struct logger_log *log,
+				struct logger_reader *reader, u32 pos)
+{
+	size_t target = logger_offset(pos);
+	size_t dist = logger_offset(target - reader->r_off);
+	size_t off = reader->r_off;
+
+	if (logger_reader_in_archive(reader))
+		return -EBUSY;
+	if (dist > logger_offset(log->w_off - reader->r_off))
+		return -EINVAL;
+	while (off != target) {
+		size_t len = get_entry_len(log, off);
+
+		if (len > logger_offset(target - off))
+			return -EINVAL;
+		off = logger_offset(off + len);
+	}
+	reader->r_off = off;
+	return 0;
+}
+
+/*
+ * logger_mmap - map the log read-only: the struct logger_mmap_header page,
+ * then the ring
+ */
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_log *log = file_get_log(file);
+	unsigned long addr = vma->vm_start + PAGE_SIZE;
+	size_t off;
+	int ret;
+
+	if (!(file->f_mode & FMODE_READ) || !log->mmap_hdr)
+		return -ENODEV;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE + log->size)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	ret = remap_pfn_range(vma, vma->vm_start,
+			      virt_to_phys(log->mmap_hdr) >> PAGE_SHIFT,
+			      PAGE_SIZE, vma->vm_page_prot);
+
+	/* the rings are static, so vmalloc space when we are a module */
+	for (off = 0; !ret && off < log->size; off += PAGE_SIZE) {
+		void *p = log->buffer + off;
+		unsigned long pfn = is_vmalloc_addr(p) ? vmalloc_to_pfn(p) :
+				    virt_to_phys(p) >> PAGE_SHIFT;
+
+		ret = remap_pfn_range(vma, addr + off, pfn, PAGE_SIZE,
+				      vma->vm_page_prot);
+	}
+	return ret;
+}
+
 static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct logger_log *log = file_get_log(file);
 	struct logger_reader *reader;
+	size_t off;
 	long ret = -ENOTTY;
 
 	mutex_lock(&log->mutex);
+	spin_lock(&log->lock);
 
 	switch (cmd) {
 	case LOGGER_GET_LOG_BUF_SIZE:
@@ -567,10 +1274,12 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
-		if (log->w_off >= reader->r_off)
-			ret = log->w_off - reader->r_off;
+		off = logger_reader_ring_off(log, reader);
+		if (log->w_off >= off)
+			ret = log->w_off - off;
 		else
-			ret = (log->size - reader->r_off) + log->w_off;
+			ret = (log->size - off) + log->w_off;
+		ret += logger_archive_len(log, reader);
 		break;
 	case LOGGER_GET_NEXT_ENTRY_LEN:
 		if (!(file->f_mode & FMODE_READ)) {
@@ -578,6 +1287,14 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
+		if (logger_reader_in_archive(reader)) {
+			/* unpacking may sleep, log->mutex keeps us stable */
+			spin_unlock(&log->lock);
+			ret = logger_archive_entry_len(log, reader);
+			spin_lock(&log->lock);
+			if (ret)
+				break;
+		}
 		if (log->w_off != reader->r_off)
 			ret = get_entry_len(log, reader->r_off);
 		else
@@ -591,10 +1308,31 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		list_for_each_entry(reader, &log->readers, list)
 			reader->r_off = log->w_off;
 		log->head = log->w_off;
+		log->head_count = log->w_count;
+		logger_publish(log);
+		logger_archive_flush(log);
 		ret = 0;
 		break;
+	case LOGGER_SET_BATCH_READ:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		reader->batch = !!arg;
+		ret = 0;
+		break;
+	case LOGGER_SET_READ_POS:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		ret = logger_set_read_pos(log, reader, arg);
+		break;
 	}
 
+	spin_unlock(&log->lock);
 	mutex_unlock(&log->mutex);
 
 	return ret;
@@ -607,17 +1345,18 @@ static const struct file_operations logger_fops = {
 	.poll = logger_poll,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
+	.mmap = logger_mmap,
 	.open = logger_open,
 	.release = logger_release,
 };
 
 /*
  * Defines a log structure with name 'NAME' and a size of 'SIZE' bytes, which
- * must be a power of two, greater than LOGGER_ENTRY_MAX_LEN, and less than
- * LONG_MAX minus LOGGER_ENTRY_MAX_LEN.
+ * must be a power of two, at least PAGE_SIZE, greater than
+ * LOGGER_ENTRY_MAX_LEN, and less than LONG_MAX minus LOGGER_ENTRY_MAX_LEN.
  */
 #define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
-static unsigned char _buf_ ## VAR[SIZE]; \
+static unsigned char _buf_ ## VAR[SIZE] __aligned(PAGE_SIZE); \
 static struct logger_log VAR = { \
 	.buffer = _buf_ ## VAR, \
 	.misc = { \
@@ -629,15 +1368,25 @@ static struct logger_log VAR = { \
 	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .wq), \
 	.readers = LIST_HEAD_INIT(VAR .readers), \
 	.mutex = __MUTEX_INITIALIZER(VAR .mutex), \
+	.lock = __SPIN_LOCK_UNLOCKED(VAR .lock), \
 	.w_off = 0, \
+	.w_reserve = 0, \
+	.w_inflight = 0, \
+	.pending = LIST_HEAD_INIT(VAR .pending), \
+	.w_wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .w_wq), \
+	LOGGER_ARCHIVE_INIT(VAR) \
 	.head = 0, \
 	.size = SIZE, \
+	.w_count = 0, \
+	.w_reserve_count = 0, \
+	.head_count = 0, \
+	.mmap_hdr = NULL, \
 };
 
-DEFINE_LOGGER_DEVICE(log_main,   LOGGER_LOG_MAIN,   512*1024)
-DEFINE_LOGGER_DEVICE(log_events, LOGGER_LOG_EVENTS, 256*1024)
-DEFINE_LOGGER_DEVICE(log_radio,  LOGGER_LOG_RADIO,  256*1024)
-DEFINE_LOGGER_DEVICE(log_system, LOGGER_LOG_SYSTEM,  64*1024)
+DEFINE_LOGGER_DEVICE(log_main,   LOGGER_LOG_MAIN,   LOGGER_RING_SIZE(512*1024))
+DEFINE_LOGGER_DEVICE(log_events, LOGGER_LOG_EVENTS, LOGGER_RING_SIZE(256*1024))
+DEFINE_LOGGER_DEVICE(log_radio,  LOGGER_LOG_RADIO,  LOGGER_RING_SIZE(256*1024))
+DEFINE_LOGGER_DEVICE(log_system, LOGGER_LOG_SYSTEM, LOGGER_RING_SIZE(64*1024))
 
 static struct logger_log *get_log_from_minor(int minor)
 {
@@ -656,6 +1405,13 @@ static int __init init_log(struct logger_log *log)
 {
 	int ret;
 
+	/* without it the log just cannot be mmap()ed */
+	log->mmap_hdr = (void *)get_zeroed_page(GFP_KERNEL);
+	if (log->mmap_hdr) {
+		log->mmap_hdr->size = log->size;
+		logger_publish(log);
+	}
+
 	ret = misc_register(&log->misc);
 	if (unlikely(ret)) {
 		printk(KERN_ERR "logger: failed to register misc "
@@ -683,6 +1439,9 @@ static int __init logger_init(void)
 
 	marks_ver_mark.log_mark_version = 1; 
 	
+	/* without it the logs simply keep no compressed history */
+	logger_archive_init();
+
 	ret = init_log(&log_main);
 	if (unlikely(ret))
 		goto out;
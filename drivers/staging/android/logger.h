@@ -30,6 +30,21 @@ struct logger_entry {
 	char		msg[0];	/* the entry's payload */
 };
 
+/*
+ * struct logger_mmap_header - first page of a read-only mmap() of a log,
+ * followed by the ring itself. The counts are byte positions since boot,
+ * modulo 2^32; a count's offset into the ring is count & (size - 1).
+ *
+ * An entry copied out from count 'pos' is intact if, after the copy,
+ * w_reserve_count - pos <= size. If it is not, resume at head_count.
+ */
+struct logger_mmap_header {
+	__u32		size;		/* size of the ring */
+	__u32		w_count;	/* end of committed entries */
+	__u32		w_reserve_count; /* end of space claimed by writers */
+	__u32		head_count;	/* oldest entry still in the ring */
+};
+
 #define LOGGER_LOG_RADIO	"log_radio"	/* radio-related messages */
 #define LOGGER_LOG_EVENTS	"log_events"	/* system/hardware events */
 #define LOGGER_LOG_SYSTEM	"log_system"	/* system/framework messages */
@@ -45,5 +60,7 @@ struct logger_entry {
 #define LOGGER_GET_LOG_LEN		_IO(__LOGGERIO, 2) /* used log len */
 #define LOGGER_GET_NEXT_ENTRY_LEN	_IO(__LOGGERIO, 3) /* next entry len */
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
+#define LOGGER_SET_BATCH_READ		_IO(__LOGGERIO, 5) /* read() many */
+#define LOGGER_SET_READ_POS		_IO(__LOGGERIO, 6) /* mmap reader pos */
 
 #endif /* _LINUX_LOGGER_H */
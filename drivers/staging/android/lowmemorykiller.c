@@ -12,6 +12,22 @@
  * and kill processes with a oom_adj value of 0 or higher when the free memory
  * drops below 1024 pages.
  *
+ * Candidates are taken from the oom_adj buckets kept by the core (see
+ * oom_adj_buckets in mm/oom_kill.c), highest oom_adj first, so a shrinker
+ * call only looks at the processes it would actually consider killing.
+ *
+ * /dev/lowmem_pressure reports how close the killer is to acting, so
+ * user-space can trim caches first. read() returns one of "none", "low",
+ * "medium" or "critical", then end of file until the level changes, and
+ * poll() signals POLLIN once the level differs from the one last read
+ * (POLLPRI from "medium" up). The level is "low" within pressure_margin
+ * percent above the last minfree threshold, "medium" below it (cached
+ * processes are being killed) and "critical" below the next one down. It
+ * is raised one step when less than pressure_efficiency percent of the
+ * pages vmscan scanned were reclaimed. The shrinker only runs under
+ * pressure, so while the level is above "none" it is also rechecked every
+ * second, which is how pollers learn that it went down again.
+ *
  * The driver considers memory used for caches to be free, but if a large
  * percentage of the cached memory is locked this can be very inaccurate
  * and processes may not get killed until the normal oom killer is triggered.
@@ -35,6 +51,12 @@
 #include <linux/oom.h>
 #include <linux/sched.h>
 #include <linux/notifier.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+#include <linux/workqueue.h>
 
 static uint32_t lowmem_debug_level = 2;
 static int lowmem_adj[6] = {
@@ -60,6 +82,29 @@ static struct task_struct *lowmem_deathpending;
 			printk(x);			\
 	} while (0)
 
+enum {
+	LOWMEM_PRESSURE_NONE,
+	LOWMEM_PRESSURE_LOW,
+	LOWMEM_PRESSURE_MEDIUM,
+	LOWMEM_PRESSURE_CRITICAL,
+};
+
+static const char *lowmem_pressure_names[] = {
+	"none",
+	"low",
+	"medium",
+	"critical",
+};
+
+static int lowmem_pressure_margin = 25;		/* percent */
+static int lowmem_pressure_efficiency = 25;	/* percent */
+static int lowmem_pressure;
+static DEFINE_SPINLOCK(lowmem_pressure_lock);
+static DECLARE_WAIT_QUEUE_HEAD(lowmem_pressure_wait);
+
+static void lowmem_pressure_recheck(struct work_struct *work);
+static DECLARE_DELAYED_WORK(lowmem_pressure_work, lowmem_pressure_recheck);
+
 static int
 task_notify_func(struct notifier_block *self, unsigned long val, void *data);
 
@@ -78,21 +123,163 @@ task_notify_func(struct notifier_block *self, unsigned long val, void *data)
 	return NOTIFY_OK;
 }
 
+/*
+ * lowmem_task_size - rss of the first thread in 'sig' that still has an mm
+ *
+ * Caller must hold tasklist_lock.
+ */
+static int lowmem_task_size(struct signal_struct *sig,
+			    struct task_struct **taskp)
+{
+	struct task_struct *p = sig->curr_target;
+	struct task_struct *t = p;
+	int tasksize;
+
+	do {
+		task_lock(t);
+		if (t->mm) {
+			tasksize = get_mm_rss(t->mm);
+			task_unlock(t);
+			*taskp = t;
+			return tasksize;
+		}
+		task_unlock(t);
+	} while_each_thread(p, t);
+
+	return 0;
+}
+
+#ifdef CONFIG_VM_EVENT_COUNTERS
+static unsigned long lowmem_sum_events(int first, int last)
+{
+	unsigned long sum = 0;
+	int cpu, i;
+
+	for_each_online_cpu(cpu) {
+		struct vm_event_state *this = &per_cpu(vm_event_states, cpu);
+
+		for (i = first; i <= last; i++)
+			sum += this->event[i];
+	}
+	return sum;
+}
+
+/*
+ * lowmem_reclaim_struggling - did vmscan reclaim less than
+ * lowmem_pressure_efficiency percent of what it scanned recently?
+ *
+ * Caller must hold lowmem_pressure_lock.
+ */
+static int lowmem_reclaim_struggling(void)
+{
+	static unsigned long last_scan, last_steal, last_time;
+	static int struggling;
+	unsigned long scan, steal;
+
+	if (time_before(jiffies, last_time + HZ / 4))
+		return struggling;
+
+	steal = lowmem_sum_events(PGREFILL_MOVABLE + 1, PGSTEAL_MOVABLE);
+	scan = lowmem_sum_events(PGSTEAL_MOVABLE + 1, PGSCAN_DIRECT_MOVABLE);
+	/* ignore windows with too little reclaim to judge by */
+	if (scan - last_scan >= SWAP_CLUSTER_MAX * 4)
+		struggling = (steal - last_steal) * 100 <
+			     (scan - last_scan) * lowmem_pressure_efficiency;
+	else
+		struggling = 0;
+	last_scan = scan;
+	last_steal = steal;
+	last_time = jiffies;
+	return struggling;
+}
+#else
+static inline int lowmem_reclaim_struggling(void)
+{
+	return 0;
+}
+#endif
+
+static int lowmem_array_size(void)
+{
+	int array_size = ARRAY_SIZE(lowmem_adj);
+
+	if (lowmem_adj_size < array_size)
+		array_size = lowmem_adj_size;
+	if (lowmem_minfree_size < array_size)
+		array_size = lowmem_minfree_size;
+	return array_size;
+}
+
+/*
+ * lowmem_pressure_update - recompute the pressure level from the free
+ * memory the killer sees and wake up pollers if it changed
+ */
+static int lowmem_pressure_update(int other_free, int other_file)
+{
+	int array_size = lowmem_array_size();
+	int free = other_free + other_file;
+	int level = LOWMEM_PRESSURE_NONE;
+	int old;
+
+	if (array_size > 0) {
+		size_t top = lowmem_minfree[array_size - 1];
+
+		if (free < top + top * lowmem_pressure_margin / 100)
+			level = LOWMEM_PRESSURE_LOW;
+		if (free < top)
+			level = LOWMEM_PRESSURE_MEDIUM;
+		if (array_size > 1 && free < lowmem_minfree[array_size - 2])
+			level = LOWMEM_PRESSURE_CRITICAL;
+	}
+
+	spin_lock(&lowmem_pressure_lock);
+	if (lowmem_reclaim_struggling() && level < LOWMEM_PRESSURE_CRITICAL)
+		level++;
+	old = lowmem_pressure;
+	lowmem_pressure = level;
+	spin_unlock(&lowmem_pressure_lock);
+
+	if (level != old) {
+		lowmem_print(3, "lowmem pressure %s\n",
+			     lowmem_pressure_names[level]);
+		wake_up_interruptible(&lowmem_pressure_wait);
+	}
+	if (level != LOWMEM_PRESSURE_NONE)
+		schedule_delayed_work(&lowmem_pressure_work, HZ);
+	return level;
+}
+
+static int lowmem_pressure_current(void)
+{
+	return lowmem_pressure_update(global_page_state(NR_FREE_PAGES),
+				      global_page_state(NR_INACTIVE_FILE) +
+				      global_page_state(NR_ACTIVE_FILE));
+}
+
+static void lowmem_pressure_recheck(struct work_struct *work)
+{
+	lowmem_pressure_current();
+}
+
 static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
 {
 	struct task_struct *p;
+	struct signal_struct *sig;
+	struct hlist_node *pos;
 	struct task_struct *selected = NULL;
 	int rem = 0;
 	int tasksize;
 	int i;
+	int oom_adj;
 	int min_adj = OOM_ADJUST_MAX + 1;
 	int selected_tasksize = 0;
 	int selected_oom_adj;
-	int array_size = ARRAY_SIZE(lowmem_adj);
+	int array_size;
 	int other_free = global_page_state(NR_FREE_PAGES);
 //	int other_file = global_page_state(NR_FILE_PAGES);
 	int other_file = global_page_state(NR_INACTIVE_FILE) + global_page_state(NR_ACTIVE_FILE);
 	
+	lowmem_pressure_update(other_free, other_file);
 
 	/*
 	 * If we already have a death outstanding, then
@@ -104,10 +291,7 @@ static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
 	if (lowmem_deathpending)
 		return 0;
 
-	if (lowmem_adj_size < array_size)
-		array_size = lowmem_adj_size;
-	if (lowmem_minfree_size < array_size)
-		array_size = lowmem_minfree_size;
+	array_size = lowmem_array_size();
 	for (i = 0; i < array_size; i++) {
 #if 1
 		if ((other_free + other_file) < lowmem_minfree[i])
@@ -141,42 +325,36 @@ static int lowmem_shrink(int nr_to_scan, gfp_t gfp_mask)
 	}
 
 	selected_oom_adj = min_adj;
+	if (min_adj < OOM_DISABLE)
+		min_adj = OOM_DISABLE;
 
+	/*
+	 * tasklist_lock keeps the groups on the buckets from being released
+	 * until the signal below has been sent; oom_adj_lock keeps the
+	 * buckets stable while we look.  It is taken under ->siglock, which
+	 * interrupts take too, so it must be taken with interrupts off.
+	 */
 	read_lock(&tasklist_lock);
-	for_each_process(p) {
-		struct mm_struct *mm;
-		struct signal_struct *sig;
-		int oom_adj;
-
-		task_lock(p);
-		mm = p->mm;
-		sig = p->signal;
-		if (!mm || !sig) {
-			task_unlock(p);
-			continue;
-		}
-		oom_adj = sig->oom_adj;
-		if (oom_adj < min_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_adj < selected_oom_adj)
+	spin_lock_irq(&oom_adj_lock);
+	for (oom_adj = OOM_ADJUST_MAX; oom_adj >= min_adj && !selected;
+	     oom_adj--) {
+		hlist_for_each_entry(sig, pos,
+				     &oom_adj_buckets[oom_adj - OOM_DISABLE],
+				     oom_adj_node) {
+			tasksize = lowmem_task_size(sig, &p);
+			if (tasksize <= 0)
 				continue;
-			if (oom_adj == selected_oom_adj &&
-			    tasksize <= selected_tasksize)
+			if (selected && tasksize <= selected_tasksize)
 				continue;
+			selected = p;
+			selected_tasksize = tasksize;
+			selected_oom_adj = oom_adj;
+			lowmem_print(2, "select %d (%s), adj %d, size %d, "
+				     "to kill\n", p->pid, p->comm, oom_adj,
+				     tasksize);
 		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_adj = oom_adj;
-		lowmem_print(2, "select %d (%s), adj %d, size %d, to kill\n",
-			     p->pid, p->comm, oom_adj, tasksize);
 	}
+	spin_unlock_irq(&oom_adj_lock);
 	if (selected) {
 		lowmem_print(1, "send sigkill to %d (%s), adj %d, size %d\n",
 			     selected->pid, selected->comm,
@@ -198,15 +376,69 @@ static struct shrinker lowmem_shrinker = {
 	.seeks = DEFAULT_SEEKS * 16
 };
 
+/* private_data holds the level this file last read */
+static int lowmem_pressure_open(struct inode *inode, struct file *file)
+{
+	file->private_data = (void *)LOWMEM_PRESSURE_NONE;
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t lowmem_pressure_read(struct file *file, char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	char level[16];
+	int l = lowmem_pressure_current();
+	int len = snprintf(level, sizeof(level), "%s\n",
+			   lowmem_pressure_names[l]);
+
+	/* a new level is read from the start, an old one only once */
+	if (l != (long)file->private_data)
+		*ppos = 0;
+	file->private_data = (void *)(long)l;
+	return simple_read_from_buffer(buf, count, ppos, level, len);
+}
+
+static unsigned int lowmem_pressure_poll(struct file *file, poll_table *wait)
+{
+	unsigned int ret = 0;
+	int l;
+
+	poll_wait(file, &lowmem_pressure_wait, wait);
+	l = lowmem_pressure;
+	if (l != (long)file->private_data)
+		ret |= POLLIN | POLLRDNORM;
+	if (l >= LOWMEM_PRESSURE_MEDIUM)
+		ret |= POLLPRI;
+	return ret;
+}
+
+static const struct file_operations lowmem_pressure_fops = {
+	.owner = THIS_MODULE,
+	.open = lowmem_pressure_open,
+	.read = lowmem_pressure_read,
+	.poll = lowmem_pressure_poll,
+};
+
+static struct miscdevice lowmem_pressure_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "lowmem_pressure",
+	.fops = &lowmem_pressure_fops,
+};
+
 static int __init lowmem_init(void)
 {
 	register_shrinker(&lowmem_shrinker);
+	if (misc_register(&lowmem_pressure_misc))
+		printk(KERN_ERR "lowmemorykiller: failed to register "
+		       "pressure device\n");
 	return 0;
 }
 
 static void __exit lowmem_exit(void)
 {
+	misc_deregister(&lowmem_pressure_misc);
 	unregister_shrinker(&lowmem_shrinker);
+	cancel_delayed_work_sync(&lowmem_pressure_work);
 }
 
 module_param_named(cost, lowmem_shrinker.seeks, int, S_IRUGO | S_IWUSR);
@@ -215,6 +447,10 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(pressure_margin, lowmem_pressure_margin, int,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_efficiency, lowmem_pressure_efficiency, int,
+		   S_IRUGO | S_IWUSR);
 
 module_init(lowmem_init);
 module_exit(lowmem_exit);
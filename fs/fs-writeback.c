@@ -1219,6 +1219,34 @@ void writeback_inodes_sb(struct super_block *sb)
 }
 EXPORT_SYMBOL(writeback_inodes_sb);
 
+/**
+ * writeback_inodes_sb_older_than	-	writeback old dirty inodes from a sb
+ * @sb: the superblock
+ * @older_than: only inodes first dirtied before this jiffies value
+ * @nr_pages: maximum number of pages to submit
+ *
+ * Like writeback_inodes_sb(), but done synchronously in the caller's context
+ * and limited both by age and by page count, so a caller with a time budget
+ * can call it repeatedly. Does not wait for IO completion. The caller must
+ * hold a reference on @sb and s_umount for reading. Returns the number of
+ * pages submitted.
+ */
+long writeback_inodes_sb_older_than(struct super_block *sb,
+				    unsigned long older_than, long nr_pages)
+{
+	struct writeback_control wbc = {
+		.bdi			= sb->s_bdi,
+		.sb			= sb,
+		.sync_mode		= WB_SYNC_NONE,
+		.older_than_this	= &older_than,
+		.nr_to_write		= nr_pages,
+		.range_cyclic		= 1,
+	};
+
+	writeback_inodes_wbc(&wbc);
+	return nr_pages - wbc.nr_to_write;
+}
+
 /**
  * sync_inodes_sb	-	sync sb inode pages
  * @sb: the superblock
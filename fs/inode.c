@@ -37,6 +37,7 @@
  * FIXME: remove all knowledge of the buffer layer from this file
  */
 #include <linux/buffer_head.h>
+#include <linux/cleancache.h>
 
 /*
  * New inode.c implementation.
@@ -323,6 +324,9 @@ void clear_inode(struct inode *inode)
 	BUG_ON(inode->i_data.nrpages);
 	BUG_ON(!(inode->i_state & I_FREEING));
 	BUG_ON(inode->i_state & I_CLEAR);
+	if (inode->i_data.page_tree.rnode)
+		clear_shadow_entries(&inode->i_data, 0, (pgoff_t)-1);
+	cleancache_flush_inode(&inode->i_data);
 	inode_sync_wait(inode);
 	vfs_dq_drop(inode);
 	if (inode->i_sb->s_op->clear_inode)
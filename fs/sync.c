@@ -121,6 +121,76 @@ restart:
 	mutex_unlock(&mutex);
 }
 
+/*
+ * Pages submitted per writeback_inodes_sb_older_than() call; small enough
+ * that the deadline and the abort callback are checked often.
+ */
+#define BOUNDED_SYNC_CHUNK	256
+
+/**
+ * sync_filesystems_bounded - start writeback of old dirty data, on a budget
+ * @older_than: only write inodes first dirtied before this jiffies value
+ * @deadline: jiffies value after which no further writeback is started
+ * @abort: if non-NULL, polled between chunks; writeback stops once it
+ *	returns non-zero
+ * @written: if non-NULL, receives the number of pages submitted
+ *
+ * A cheaper alternative to sys_sync() for callers that only need data which
+ * has been dirty for a while to be on its way to disk, such as the
+ * automatic suspend path.  Inodes dirtied more recently, filesystem metadata
+ * and the wait for IO completion are left to the flusher threads.  Returns
+ * 0 when everything old enough was submitted, -ETIMEDOUT if @deadline
+ * passed first and -EBUSY if @abort fired.
+ */
+int sync_filesystems_bounded(unsigned long older_than, unsigned long deadline,
+			     int (*abort)(void), long *written)
+{
+	struct super_block *sb;
+	long total = 0;
+	int need_restart;
+	int ret = 0;
+
+	spin_lock(&sb_lock);
+restart:
+	list_for_each_entry(sb, &super_blocks, s_list) {
+		sb->s_count++;
+		spin_unlock(&sb_lock);
+
+		down_read(&sb->s_umount);
+		while (!ret && !(sb->s_flags & MS_RDONLY) && sb->s_root &&
+		       sb->s_bdi) {
+			long n;
+
+			if (abort && abort())
+				ret = -EBUSY;
+			else if (time_after(jiffies, deadline))
+				ret = -ETIMEDOUT;
+			if (ret)
+				break;
+			n = writeback_inodes_sb_older_than(sb, older_than,
+							   BOUNDED_SYNC_CHUNK);
+			total += n;
+			if (n < BOUNDED_SYNC_CHUNK)
+				break;
+		}
+		up_read(&sb->s_umount);
+
+		/* restart only when sb is no longer on the list */
+		spin_lock(&sb_lock);
+		need_restart = __put_super_and_need_restart(sb);
+		if (ret)
+			break;
+		if (need_restart)
+			goto restart;
+	}
+	spin_unlock(&sb_lock);
+
+	if (written)
+		*written = total;
+	return ret;
+}
+EXPORT_SYMBOL(sync_filesystems_bounded);
+
 /*
  * sync everything.  Start out by waking pdflush, because that writes back
  * all queues in parallel.
@@ -756,6 +756,8 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 		SetPageError(pg);
 	} else {
 		SetPageUptodate(pg);
+		/* all of it came from flash, so cleancache may keep it */
+		SetPageMappedToDisk(pg);
 		ClearPageError(pg);
 	}
 
@@ -13,6 +13,7 @@
 #define _LINUX_ASHMEM_H
 
 #include <linux/limits.h>
+#include <linux/types.h>
 #include <linux/ioctl.h>
 
 #define ASHMEM_NAME_LEN		256
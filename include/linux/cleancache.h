@@ -0,0 +1,88 @@
+#ifndef _LINUX_CLEANCACHE_H
+#define _LINUX_CLEANCACHE_H
+
+/*
+ * cleancache - compressed in-memory copies of evicted clean file pages
+ *
+ * See Documentation/vm/cleancache.txt.
+ */
+
+#include <linux/fs.h>
+#include <linux/mm.h>
+
+#ifdef CONFIG_CLEANCACHE
+
+extern int cleancache_enabled;
+
+extern void __cleancache_put_page(struct address_space *mapping,
+				  struct page *page);
+extern int __cleancache_get_page(struct page *page);
+extern void __cleancache_flush_page(struct address_space *mapping,
+				    struct page *page);
+extern void __cleancache_flush_inode(struct address_space *mapping);
+
+/*
+ * Only regular files on block device filesystems are cached: their page
+ * cache is the only way their data changes, so a copy stays valid until
+ * the page is truncated or invalidated, which flushes it.
+ */
+static inline int cleancache_mapping(struct address_space *mapping)
+{
+	struct inode *inode = mapping->host;
+
+	return cleancache_enabled && inode && S_ISREG(inode->i_mode) &&
+	       (inode->i_sb->s_type->fs_flags & FS_REQUIRES_DEV);
+}
+
+/*
+ * Called with the mapping's tree_lock held as @page leaves the page cache.
+ * Up to date pages whose blocks are all on disk are kept; for anything
+ * else (truncation, invalidation) an older copy is dropped.
+ */
+static inline void cleancache_put_page(struct address_space *mapping,
+				       struct page *page)
+{
+	if (!cleancache_mapping(mapping))
+		return;
+	if (PageUptodate(page) && PageMappedToDisk(page) && !PageDirty(page))
+		__cleancache_put_page(mapping, page);
+	else
+		__cleancache_flush_page(mapping, page);
+}
+
+/*
+ * Fill a locked, newly added page cache page from cleancache.  Returns 0
+ * and marks the page up to date on a hit; the caller unlocks it.
+ */
+static inline int cleancache_get_page(struct page *page)
+{
+	if (!cleancache_mapping(page->mapping))
+		return -1;
+	return __cleancache_get_page(page);
+}
+
+static inline void cleancache_flush_inode(struct address_space *mapping)
+{
+	if (cleancache_mapping(mapping))
+		__cleancache_flush_inode(mapping);
+}
+
+#else
+
+static inline void cleancache_put_page(struct address_space *mapping,
+				       struct page *page)
+{
+}
+
+static inline int cleancache_get_page(struct page *page)
+{
+	return -1;
+}
+
+static inline void cleancache_flush_inode(struct address_space *mapping)
+{
+}
+
+#endif /* CONFIG_CLEANCACHE */
+
+#endif /* _LINUX_CLEANCACHE_H */
@@ -21,6 +21,7 @@
 #include <linux/workqueue.h>
 #include <linux/cpumask.h>
 #include <asm/div64.h>
+#include <asm/cputime.h>
 
 #define CPUFREQ_NAME_LEN 16
 
@@ -193,6 +194,8 @@ extern int __cpufreq_driver_target(struct cpufreq_policy *policy,
 extern int __cpufreq_driver_getavg(struct cpufreq_policy *policy,
 				   unsigned int cpu);
 
+extern unsigned int cpufreq_sched_max(struct cpufreq_policy *policy);
+
 int cpufreq_register_governor(struct cpufreq_governor *governor);
 void cpufreq_unregister_governor(struct cpufreq_governor *governor);
 
@@ -327,6 +330,10 @@ static inline unsigned int cpufreq_quick_get(unsigned int cpu)
 #ifdef CONFIG_CPU_FREQ_GOV_PERFORMANCE
 extern struct cpufreq_governor cpufreq_gov_performance;
 #endif
+#if defined(CONFIG_CPU_FREQ_GOV_INTERACTIVE) || \
+    defined(CONFIG_CPU_FREQ_GOV_INTERACTIVE_MODULE)
+extern struct cpufreq_governor cpufreq_gov_interactive;
+#endif
 #ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_PERFORMANCE
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_performance)
 #elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_POWERSAVE)
@@ -341,6 +348,8 @@ extern struct cpufreq_governor cpufreq_gov_ondemand;
 #elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_CONSERVATIVE)
 extern struct cpufreq_governor cpufreq_gov_conservative;
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_conservative)
+#elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE)
+#define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_interactive)
 #endif
 
 
@@ -378,6 +387,17 @@ void   cpufreq_cpu_put (struct cpufreq_policy *data);
 /* the following are really really optional */
 extern struct freq_attr cpufreq_freq_attr_scaling_available_freqs;
 
+/* per-uid accounting in cpufreq_stats.c, called by the scheduler */
+struct task_struct;
+#ifdef CONFIG_CPU_FREQ_STAT_UID
+void cpufreq_stats_uid_account(struct task_struct *p, cputime_t cputime);
+void cpufreq_stats_uid_exit(struct task_struct *p);
+#else
+static inline void cpufreq_stats_uid_account(struct task_struct *p,
+					     cputime_t cputime) {}
+static inline void cpufreq_stats_uid_exit(struct task_struct *p) {}
+#endif
+
 void cpufreq_frequency_table_get_attr(struct cpufreq_frequency_table *table, 
 				      unsigned int cpu);
 
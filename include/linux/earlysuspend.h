@@ -18,6 +18,7 @@
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/list.h>
+#include <linux/ktime.h>
 #endif
 
 /* The early_suspend structure defines suspend and resume hooks to be called
@@ -29,18 +30,31 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ *
+ * A handler that sets EARLY_SUSPEND_ASYNC in flags only depends on the
+ * handlers of other levels: it runs in parallel with the other handlers of
+ * its level, and all of them complete before the next level is started.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
 	EARLY_SUSPEND_LEVEL_STOP_DRAWING = 100,
 	EARLY_SUSPEND_LEVEL_DISABLE_FB = 150,
 };
+enum {
+	EARLY_SUSPEND_ASYNC = 1U << 0,
+};
 struct early_suspend {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct list_head link;
 	int level;
+	unsigned int flags;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	/* handler run times, kept by the early suspend core */
+	ktime_t suspend_time;
+	ktime_t resume_time;
+	ktime_t max_suspend_time;
+	ktime_t max_resume_time;
 #endif
 };
 
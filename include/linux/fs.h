@@ -1971,6 +1971,9 @@ static inline int thaw_bdev(struct block_device *bdev, struct super_block *sb)
 }
 #endif
 extern int sync_filesystem(struct super_block *);
+extern int sync_filesystems_bounded(unsigned long older_than,
+				    unsigned long deadline,
+				    int (*abort)(void), long *written);
 extern const struct file_operations def_blk_fops;
 extern const struct file_operations def_chr_fops;
 extern const struct file_operations bad_sock_fops;
@@ -10,9 +10,12 @@
 #ifdef __KERNEL__
 
 #include <linux/types.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
 
 struct zonelist;
 struct notifier_block;
+struct signal_struct;
 
 /*
  * Types of limitations to the nodes from which allocations may occur
@@ -41,5 +44,35 @@ static inline void oom_killer_enable(void)
 {
 	oom_killer_disabled = false;
 }
+
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+/*
+ * Thread groups hashed by oom_adj, so the low memory killer can go
+ * straight to the candidates it may kill. Buckets are indexed by
+ * oom_adj - OOM_DISABLE and protected by oom_adj_lock, which nests
+ * inside tasklist_lock and ->siglock.  It is irq-safe: every user must
+ * hold it with interrupts disabled.
+ */
+#define OOM_ADJ_BUCKETS	(OOM_ADJUST_MAX - OOM_DISABLE + 1)
+
+extern spinlock_t oom_adj_lock;
+extern struct hlist_head oom_adj_buckets[OOM_ADJ_BUCKETS];
+
+extern void oom_adj_add(struct signal_struct *sig);
+extern void oom_adj_del(struct signal_struct *sig);
+extern void oom_adj_update(struct signal_struct *sig);
+#else
+static inline void oom_adj_add(struct signal_struct *sig)
+{
+}
+
+static inline void oom_adj_del(struct signal_struct *sig)
+{
+}
+
+static inline void oom_adj_update(struct signal_struct *sig)
+{
+}
+#endif
 #endif /* __KERNEL__*/
 #endif /* _INCLUDE_LINUX_OOM_H */
@@ -0,0 +1,56 @@
+/*
+ *  pm_profile.h - Suspend/resume latency profiling
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_PM_PROFILE_H
+#define _LINUX_PM_PROFILE_H
+
+#include <linux/device.h>
+#include <linux/sched.h>
+
+enum pm_profile_phase {
+	PM_PROFILE_STAGE,		/* a whole step of suspend_enter() etc. */
+	PM_PROFILE_SUSPEND,
+	PM_PROFILE_SUSPEND_NOIRQ,
+	PM_PROFILE_SYSDEV_SUSPEND,
+	PM_PROFILE_SYSDEV_RESUME,
+	PM_PROFILE_RESUME_NOIRQ,
+	PM_PROFILE_RESUME,
+};
+
+#ifdef CONFIG_PM_SLEEP_PROFILE
+
+/*
+ * sched_clock() rather than ktime_get(): the latter must not be used once
+ * the timekeeping sysdev is suspended.
+ */
+static inline u64 pm_profile_start(void)
+{
+	return sched_clock();
+}
+
+extern void pm_profile_begin(void);
+extern void pm_profile_record(enum pm_profile_phase phase, const char *name,
+			      void *fn, u64 start, int error);
+
+#else /* !CONFIG_PM_SLEEP_PROFILE */
+
+static inline u64 pm_profile_start(void) { return 0; }
+static inline void pm_profile_begin(void) {}
+static inline void pm_profile_record(enum pm_profile_phase phase,
+				     const char *name, void *fn, u64 start,
+				     int error) {}
+
+#endif /* !CONFIG_PM_SLEEP_PROFILE */
+
+static inline void pm_profile_dev(enum pm_profile_phase phase,
+				  struct device *dev, u64 start, int error)
+{
+	pm_profile_record(phase, dev_name(dev), NULL, start, error);
+}
+
+#endif /* _LINUX_PM_PROFILE_H */
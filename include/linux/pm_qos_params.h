@@ -10,12 +10,16 @@
 #define PM_QOS_CPU_DMA_LATENCY 1
 #define PM_QOS_NETWORK_LATENCY 2
 #define PM_QOS_NETWORK_THROUGHPUT 3
+#define PM_QOS_CPU_FREQ_MIN 4
+#define PM_QOS_BUS_FREQ_MIN 5
 
-#define PM_QOS_NUM_CLASSES 4
+#define PM_QOS_NUM_CLASSES 6
 #define PM_QOS_DEFAULT_VALUE -1
 
 int pm_qos_add_requirement(int qos, char *name, s32 value);
 int pm_qos_update_requirement(int qos, char *name, s32 new_value);
+int pm_qos_update_requirement_timeout(int qos, char *name, s32 new_value,
+				      unsigned long timeout_us);
 void pm_qos_remove_requirement(int qos, char *name);
 
 int pm_qos_requirement(int qos);
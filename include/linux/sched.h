@@ -665,6 +665,9 @@ struct signal_struct {
 #endif
 
 	int oom_adj;	/* OOM kill score adjustment (bit shift) */
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+	struct hlist_node oom_adj_node;	/* in oom_adj_buckets[oom_adj] */
+#endif
 };
 
 /* Context switch must be unlocked if interrupts are to be enabled */
@@ -2519,6 +2522,15 @@ extern int sched_rt_can_attach(struct task_group *tg, struct task_struct *tsk);
 #endif
 #endif
 
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_CPU_FREQ)
+extern unsigned int sched_get_freq_cap(int cpu);
+#else
+static inline unsigned int sched_get_freq_cap(int cpu)
+{
+	return UINT_MAX;
+}
+#endif
+
 extern int task_can_switch_user(struct user_struct *up,
 					struct task_struct *tsk);
 
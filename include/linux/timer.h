@@ -17,6 +17,9 @@ struct timer_list {
 	unsigned long data;
 
 	struct tvec_base *base;
+
+	int slack;
+
 #ifdef CONFIG_TIMER_STATS
 	void *start_site;
 	char start_comm[16];
@@ -48,6 +51,7 @@ extern struct tvec_base boot_tvec_bases;
 		.expires = (_expires),				\
 		.data = (_data),				\
 		.base = &boot_tvec_bases,			\
+		.slack = -1,					\
 		__TIMER_LOCKDEP_MAP_INITIALIZER(		\
 			__FILE__ ":" __stringify(__LINE__))	\
 	}
@@ -165,6 +169,8 @@ extern int mod_timer(struct timer_list *timer, unsigned long expires);
 extern int mod_timer_pending(struct timer_list *timer, unsigned long expires);
 extern int mod_timer_pinned(struct timer_list *timer, unsigned long expires);
 
+extern void set_timer_slack(struct timer_list *time, int slack_hz);
+
 #define TIMER_NOT_PINNED	0
 #define TIMER_PINNED		1
 /*
@@ -195,6 +201,8 @@ extern void timer_stats_update_stats(void *timer, pid_t pid, void *startf,
 				     void *timerf, char *comm,
 				     unsigned int timer_flag);
 
+extern void timer_stats_note_wakeup(int idle);
+
 extern void __timer_stats_timer_set_start_info(struct timer_list *timer,
 					       void *addr);
 
@@ -214,6 +222,10 @@ static inline void init_timer_stats(void)
 {
 }
 
+static inline void timer_stats_note_wakeup(int idle)
+{
+}
+
 static inline void timer_stats_timer_set_start_info(struct timer_list *timer)
 {
 }
@@ -17,6 +17,8 @@
 #define _LINUX_WAKELOCK_H
 
 #include <linux/list.h>
+#include <linux/rbtree.h>
+#include <linux/seqlock.h>
 #include <linux/ktime.h>
 
 /* A wake_lock prevents the system from entering suspend or other low power
@@ -35,11 +37,14 @@ enum {
 struct wake_lock {
 #ifdef CONFIG_HAS_WAKELOCK
 	struct list_head    link;
+	struct rb_node      expire_node;	/* active with a timeout */
+	struct hlist_node   hash_node;		/* lookup by name */
 	int                 flags;
 	const char         *name;
 	unsigned long       expires;
 #ifdef CONFIG_WAKELOCK_STAT
 	struct {
+		seqlock_t       lock;	/* writers of the counters below */
 		int             count;
 		int             expire_count;
 		int             wakeup_count;
@@ -70,6 +70,8 @@ struct bdi_writeback;
 int inode_wait(void *);
 void writeback_inodes_sb(struct super_block *);
 void sync_inodes_sb(struct super_block *);
+long writeback_inodes_sb_older_than(struct super_block *sb,
+				    unsigned long older_than, long nr_pages);
 void writeback_inodes_wbc(struct writeback_control *wbc);
 long wb_do_writeback(struct bdi_writeback *wb, int force_wait);
 void wakeup_flusher_threads(long nr_pages);
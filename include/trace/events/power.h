@@ -75,6 +75,31 @@ TRACE_EVENT(power_frequency,
 	TP_printk("type=%lu state=%lu", (unsigned long)__entry->type, (unsigned long) __entry->state)
 );
 
+TRACE_EVENT(suspend_sync,
+
+	TP_PROTO(unsigned int bounded, long pages, u64 duration_us, int ret),
+
+	TP_ARGS(bounded, pages, duration_us, ret),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	bounded		)
+		__field(	long,		pages		)
+		__field(	u64,		duration_us	)
+		__field(	int,		ret		)
+	),
+
+	TP_fast_assign(
+		__entry->bounded = bounded;
+		__entry->pages = pages;
+		__entry->duration_us = duration_us;
+		__entry->ret = ret;
+	),
+
+	TP_printk("bounded=%u pages=%ld duration_us=%llu ret=%d",
+		  __entry->bounded, __entry->pages,
+		  (unsigned long long)__entry->duration_us, __entry->ret)
+);
+
 #endif /* _TRACE_POWER_H */
 
 /* This part must be outside protection */
@@ -13,6 +13,12 @@
  * latency: usec
  * timeout: usec <-- currently not used.
  * throughput: kbs (kilo byte / sec)
+ * frequency floors: kHz
+ *
+ * A kernel requirement may be given a timeout, after which it drops back to
+ * the default value on its own.  Time spent away from the default value is
+ * accounted per requirement and shown in debugfs (pm_qos), so it is possible
+ * to see who is holding a latency or frequency constraint and for how long.
  *
  * There are lists of pm_qos_objects each one wrapping requirements, notifiers
  *
@@ -39,6 +45,12 @@
 #include <linux/string.h>
 #include <linux/platform_device.h>
 #include <linux/init.h>
+#include <linux/timer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/uaccess.h>
 
@@ -55,6 +67,13 @@ struct requirement_list {
 		s32 kbps;
 	};
 	char *name;
+	int pm_qos_class;
+	struct timer_list timeout;	/* reverts to the default value */
+	/* accounting, under pm_qos_lock */
+	unsigned long active_count;	/* times it left the default value */
+	unsigned long expire_count;	/* times its timeout fired */
+	ktime_t active_since;
+	ktime_t total_active;
 };
 
 static s32 max_compare(s32 v1, s32 v2);
@@ -104,15 +123,42 @@ static struct pm_qos_object network_throughput_pm_qos = {
 };
 
 
+static BLOCKING_NOTIFIER_HEAD(cpu_freq_min_notifier);
+static struct pm_qos_object cpu_freq_min_pm_qos = {
+	.requirements =
+		{LIST_HEAD_INIT(cpu_freq_min_pm_qos.requirements.list)},
+	.notifiers = &cpu_freq_min_notifier,
+	.name = "cpu_freq_min",
+	.default_value = 0,
+	.target_value = ATOMIC_INIT(0),
+	.comparitor = max_compare
+};
+
+static BLOCKING_NOTIFIER_HEAD(bus_freq_min_notifier);
+static struct pm_qos_object bus_freq_min_pm_qos = {
+	.requirements =
+		{LIST_HEAD_INIT(bus_freq_min_pm_qos.requirements.list)},
+	.notifiers = &bus_freq_min_notifier,
+	.name = "bus_freq_min",
+	.default_value = 0,
+	.target_value = ATOMIC_INIT(0),
+	.comparitor = max_compare
+};
+
 static struct pm_qos_object *pm_qos_array[] = {
 	&null_pm_qos,
 	&cpu_dma_pm_qos,
 	&network_lat_pm_qos,
-	&network_throughput_pm_qos
+	&network_throughput_pm_qos,
+	&cpu_freq_min_pm_qos,
+	&bus_freq_min_pm_qos
 };
 
 static DEFINE_SPINLOCK(pm_qos_lock);
 
+static void pm_qos_expire_work_fn(struct work_struct *work);
+static DECLARE_WORK(pm_qos_expire_work, pm_qos_expire_work_fn);
+
 static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
 		size_t count, loff_t *f_pos);
 static int pm_qos_power_open(struct inode *inode, struct file *filp);
@@ -163,6 +209,54 @@ static void update_target(int target)
 			(unsigned long) extreme_value, NULL);
 }
 
+/*
+ * Sets the value of a requirement and keeps its accounting.
+ * Must be called with pm_qos_lock held.
+ */
+static void set_requirement_value(struct requirement_list *node, s32 value)
+{
+	s32 default_value = pm_qos_array[node->pm_qos_class]->default_value;
+	ktime_t now = ktime_get();
+
+	if (value == PM_QOS_DEFAULT_VALUE)
+		value = default_value;
+
+	if (node->value == default_value && value != default_value) {
+		node->active_count++;
+		node->active_since = now;
+	} else if (node->value != default_value && value == default_value) {
+		node->total_active = ktime_add(node->total_active,
+				ktime_sub(now, node->active_since));
+	}
+	node->value = value;
+}
+
+/*
+ * The timeout fires in softirq context, where the blocking notifiers can't
+ * be run, so the new targets are computed from a work item.
+ */
+static void requirement_timeout(unsigned long data)
+{
+	struct requirement_list *node = (struct requirement_list *)data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_qos_lock, flags);
+	set_requirement_value(node, PM_QOS_DEFAULT_VALUE);
+	node->expire_count++;
+	spin_unlock_irqrestore(&pm_qos_lock, flags);
+
+	schedule_work(&pm_qos_expire_work);
+}
+
+static void pm_qos_expire_work_fn(struct work_struct *work)
+{
+	int pm_qos_class;
+
+	for (pm_qos_class = 1; pm_qos_class < PM_QOS_NUM_CLASSES;
+	     pm_qos_class++)
+		update_target(pm_qos_class);
+}
+
 static int register_pm_qos_misc(struct pm_qos_object *qos)
 {
 	qos->pm_qos_power_miscdev.minor = MISC_DYNAMIC_MINOR;
@@ -214,10 +308,11 @@ int pm_qos_add_requirement(int pm_qos_class, char *name, s32 value)
 
 	dep = kzalloc(sizeof(struct requirement_list), GFP_KERNEL);
 	if (dep) {
-		if (value == PM_QOS_DEFAULT_VALUE)
-			dep->value = pm_qos_array[pm_qos_class]->default_value;
-		else
-			dep->value = value;
+		dep->pm_qos_class = pm_qos_class;
+		dep->value = pm_qos_array[pm_qos_class]->default_value;
+		set_requirement_value(dep, value);
+		setup_timer(&dep->timeout, requirement_timeout,
+			    (unsigned long)dep);
 		dep->name = kstrdup(name, GFP_KERNEL);
 		if (!dep->name)
 			goto cleanup;
@@ -249,6 +344,25 @@ EXPORT_SYMBOL_GPL(pm_qos_add_requirement);
  * If the named request isn't in the list then no change is made.
  */
 int pm_qos_update_requirement(int pm_qos_class, char *name, s32 new_value)
+{
+	return pm_qos_update_requirement_timeout(pm_qos_class, name,
+						 new_value, 0);
+}
+EXPORT_SYMBOL_GPL(pm_qos_update_requirement);
+
+/**
+ * pm_qos_update_requirement_timeout - modifies an existing qos request
+ * @pm_qos_class: identifies which list of qos request to us
+ * @name: identifies the request
+ * @value: defines the qos request
+ * @timeout_us: how long the request stays in effect, 0 for no limit
+ *
+ * Like pm_qos_update_requirement(), but the request goes back to the
+ * default value by itself after @timeout_us.  A later update replaces the
+ * timeout.
+ */
+int pm_qos_update_requirement_timeout(int pm_qos_class, char *name,
+				      s32 new_value, unsigned long timeout_us)
 {
 	unsigned long flags;
 	struct requirement_list *node;
@@ -258,11 +372,13 @@ int pm_qos_update_requirement(int pm_qos_class, char *name, s32 new_value)
 	list_for_each_entry(node,
 		&pm_qos_array[pm_qos_class]->requirements.list, list) {
 		if (strcmp(node->name, name) == 0) {
-			if (new_value == PM_QOS_DEFAULT_VALUE)
-				node->value =
-				pm_qos_array[pm_qos_class]->default_value;
+			set_requirement_value(node, new_value);
+			if (timeout_us && node->value !=
+			    pm_qos_array[pm_qos_class]->default_value)
+				mod_timer(&node->timeout,
+					  jiffies + usecs_to_jiffies(timeout_us));
 			else
-				node->value = new_value;
+				del_timer(&node->timeout);
 			pending_update = 1;
 			break;
 		}
@@ -273,7 +389,7 @@ int pm_qos_update_requirement(int pm_qos_class, char *name, s32 new_value)
 
 	return 0;
 }
-EXPORT_SYMBOL_GPL(pm_qos_update_requirement);
+EXPORT_SYMBOL_GPL(pm_qos_update_requirement_timeout);
 
 /**
  * pm_qos_remove_requirement - modifies an existing qos request
@@ -293,16 +409,18 @@ void pm_qos_remove_requirement(int pm_qos_class, char *name)
 	list_for_each_entry(node,
 		&pm_qos_array[pm_qos_class]->requirements.list, list) {
 		if (strcmp(node->name, name) == 0) {
-			kfree(node->name);
 			list_del(&node->list);
-			kfree(node);
 			pending_update = 1;
 			break;
 		}
 	}
 	spin_unlock_irqrestore(&pm_qos_lock, flags);
-	if (pending_update)
+	if (pending_update) {
+		del_timer_sync(&node->timeout);
+		kfree(node->name);
+		kfree(node);
 		update_target(pm_qos_class);
+	}
 }
 EXPORT_SYMBOL_GPL(pm_qos_remove_requirement);
 
@@ -397,6 +515,54 @@ static ssize_t pm_qos_power_write(struct file *filp, const char __user *buf,
 	return  sizeof(s32);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int pm_qos_debug_show(struct seq_file *s, void *unused)
+{
+	struct requirement_list *node;
+	unsigned long flags;
+	int pm_qos_class;
+	ktime_t now = ktime_get();
+
+	seq_printf(s, "%-24s %10s %8s %8s %10s\n", "name", "value",
+		   "active", "expired", "active_ms");
+	for (pm_qos_class = 1; pm_qos_class < PM_QOS_NUM_CLASSES;
+	     pm_qos_class++) {
+		struct pm_qos_object *o = pm_qos_array[pm_qos_class];
+
+		seq_printf(s, "%s: target %d\n", o->name,
+			   atomic_read(&o->target_value));
+		spin_lock_irqsave(&pm_qos_lock, flags);
+		list_for_each_entry(node, &o->requirements.list, list) {
+			ktime_t total = node->total_active;
+
+			if (node->value != o->default_value)
+				total = ktime_add(total,
+					ktime_sub(now, node->active_since));
+			seq_printf(s, "  %-22s %10d %8lu %8lu %10lld%s\n",
+				   node->name, node->value, node->active_count,
+				   node->expire_count,
+				   div_s64(ktime_to_ns(total), NSEC_PER_MSEC),
+				   timer_pending(&node->timeout) ?
+				   " timeout" : "");
+		}
+		spin_unlock_irqrestore(&pm_qos_lock, flags);
+	}
+
+	return 0;
+}
+
+static int pm_qos_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pm_qos_debug_show, NULL);
+}
+
+static const struct file_operations pm_qos_debug_fops = {
+	.open		= pm_qos_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
 
 static int __init pm_qos_power_init(void)
 {
@@ -413,9 +579,23 @@ static int __init pm_qos_power_init(void)
 		return ret;
 	}
 	ret = register_pm_qos_misc(&network_throughput_pm_qos);
-	if (ret < 0)
+	if (ret < 0) {
 		printk(KERN_ERR
 			"pm_qos_param: network_throughput setup failed\n");
+		return ret;
+	}
+	ret = register_pm_qos_misc(&cpu_freq_min_pm_qos);
+	if (ret < 0) {
+		printk(KERN_ERR "pm_qos_param: cpu_freq_min setup failed\n");
+		return ret;
+	}
+	ret = register_pm_qos_misc(&bus_freq_min_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR "pm_qos_param: bus_freq_min setup failed\n");
+
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("pm_qos", S_IRUGO, NULL, NULL, &pm_qos_debug_fops);
+#endif
 
 	return ret;
 }
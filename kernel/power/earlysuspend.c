@@ -13,9 +13,12 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/seq_file.h>
 #include <linux/rtc.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
@@ -55,6 +58,12 @@ enum {
 };
 static int state;
 
+/* EARLY_SUSPEND_ASYNC handlers; handler_resume says which hook they run */
+static LIST_HEAD(early_suspend_async_domain);
+static int handler_resume;
+static ktime_t early_suspend_time;
+static ktime_t late_resume_time;
+
 static void sync_system(struct work_struct *work)
 {
 	pr_info("%s +\n", __func__);
@@ -64,6 +73,54 @@ static void sync_system(struct work_struct *work)
 	pr_info("%s -\n", __func__);
 }
 
+static void call_handler(struct early_suspend *handler, int resume)
+{
+	ktime_t start, delta;
+
+	start = ktime_get();
+	if (resume)
+		handler->resume(handler);
+	else
+		handler->suspend(handler);
+	delta = ktime_sub(ktime_get(), start);
+
+	if (resume) {
+		handler->resume_time = delta;
+		if (delta.tv64 > handler->max_resume_time.tv64)
+			handler->max_resume_time = delta;
+	} else {
+		handler->suspend_time = delta;
+		if (delta.tv64 > handler->max_suspend_time.tv64)
+			handler->max_suspend_time = delta;
+	}
+}
+
+static void call_handler_async(void *data, async_cookie_t cookie)
+{
+	call_handler(data, handler_resume);
+}
+
+/*
+ * Run one handler of the walk.  A change of level waits for the async
+ * handlers of the previous level, so they only overlap within a level.
+ * Caller holds early_suspend_lock.
+ */
+static void queue_handler(struct early_suspend *handler, int *level)
+{
+	if (!(handler_resume ? handler->resume : handler->suspend))
+		return;
+
+	if (handler->level != *level) {
+		async_synchronize_full_domain(&early_suspend_async_domain);
+		*level = handler->level;
+	}
+	if (handler->flags & EARLY_SUSPEND_ASYNC)
+		async_schedule_domain(call_handler_async, handler,
+				      &early_suspend_async_domain);
+	else
+		call_handler(handler, handler_resume);
+}
+
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
@@ -77,7 +134,7 @@ void register_early_suspend(struct early_suspend *handler)
 	}
 	list_add_tail(&handler->link, pos);
 	if ((state & SUSPENDED) && handler->suspend)
-		handler->suspend(handler);
+		call_handler(handler, 0);
 	mutex_unlock(&early_suspend_lock);
 }
 EXPORT_SYMBOL(register_early_suspend);
@@ -100,6 +157,8 @@ static void early_suspend(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level;
+	ktime_t start;
 #ifdef CONFIG_CPU_FREQ
 	int error;
 	struct cpufreq_policy policy;
@@ -122,10 +181,13 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-	}
+	start = ktime_get();
+	handler_resume = 0;
+	level = INT_MIN;
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		queue_handler(pos, &level);
+	async_synchronize_full_domain(&early_suspend_async_domain);
+	early_suspend_time = ktime_sub(ktime_get(), start);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -168,6 +230,8 @@ static void late_resume(struct work_struct *work)
 	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
+	int level;
+	ktime_t start;
 
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -200,9 +264,13 @@ static void late_resume(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
+	start = ktime_get();
+	handler_resume = 1;
+	level = INT_MIN;
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
-		if (pos->resume != NULL)
-			pos->resume(pos);
+		queue_handler(pos, &level);
+	async_synchronize_full_domain(&early_suspend_async_domain);
+	late_resume_time = ktime_sub(ktime_get(), start);
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 abort:
@@ -247,3 +315,47 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_stats_show(struct seq_file *m, void *unused)
+{
+	struct early_suspend *pos;
+
+	mutex_lock(&early_suspend_lock);
+	seq_printf(m, "early_suspend %lld us, late_resume %lld us\n",
+		   ktime_to_us(early_suspend_time),
+		   ktime_to_us(late_resume_time));
+	seq_printf(m, "level\tasync\tsuspend\tmax\tresume\tmax\thandler\n");
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		seq_printf(m, "%d\t%d\t%lld\t%lld\t%lld\t%lld\t%pF\n",
+			   pos->level, !!(pos->flags & EARLY_SUSPEND_ASYNC),
+			   ktime_to_us(pos->suspend_time),
+			   ktime_to_us(pos->max_suspend_time),
+			   ktime_to_us(pos->resume_time),
+			   ktime_to_us(pos->max_resume_time),
+			   pos->suspend ? (void *)pos->suspend :
+					  (void *)pos->resume);
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_stats_show, NULL);
+}
+
+static const struct file_operations early_suspend_stats_fops = {
+	.open = early_suspend_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init early_suspend_debug_init(void)
+{
+	debugfs_create_file("early_suspend", S_IRUGO, NULL, NULL,
+			    &early_suspend_stats_fops);
+	return 0;
+}
+late_initcall(early_suspend_debug_init);
+#endif
@@ -16,6 +16,7 @@
 #include <linux/cpu.h>
 #include <linux/syscalls.h>
 #include <linux/cpufreq.h>
+#include <linux/pm_profile.h>
 #ifdef CONFIG_CPU_FREQ
 #include <mach/cpu-freq-v210.h>
 #endif
@@ -131,6 +132,7 @@ void __attribute__ ((weak)) arch_suspend_enable_irqs(void)
  */
 static int suspend_enter(suspend_state_t state)
 {
+	u64 start;
 	int error;
 
 	if (suspend_ops->prepare) {
@@ -139,7 +141,10 @@ static int suspend_enter(suspend_state_t state)
 			return error;
 	}
 
+	start = pm_profile_start();
 	error = dpm_suspend_noirq(PMSG_SUSPEND);
+	pm_profile_record(PM_PROFILE_STAGE, "dpm_suspend_noirq", NULL, start,
+			  error);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to power down\n");
 		goto Platfrom_finish;
@@ -161,11 +166,17 @@ static int suspend_enter(suspend_state_t state)
 	arch_suspend_disable_irqs();
 	BUG_ON(!irqs_disabled());
 
+	start = pm_profile_start();
 	error = sysdev_suspend(PMSG_SUSPEND);
+	pm_profile_record(PM_PROFILE_STAGE, "sysdev_suspend", NULL, start,
+			  error);
 	if (!error) {
 		if (!suspend_test(TEST_CORE))
 			error = suspend_ops->enter(state);
+		start = pm_profile_start();
 		sysdev_resume();
+		pm_profile_record(PM_PROFILE_STAGE, "sysdev_resume", NULL,
+				  start, 0);
 	}
 
 	arch_suspend_enable_irqs();
@@ -179,7 +190,9 @@ static int suspend_enter(suspend_state_t state)
 		suspend_ops->wake();
 
  Power_up_devices:
+	start = pm_profile_start();
 	dpm_resume_noirq(PMSG_RESUME);
+	pm_profile_record(PM_PROFILE_STAGE, "dpm_resume_noirq", NULL, start, 0);
 
  Platfrom_finish:
 	if (suspend_ops->finish)
@@ -195,6 +208,7 @@ static int suspend_enter(suspend_state_t state)
  */
 int suspend_devices_and_enter(suspend_state_t state)
 {
+	u64 start;
 	int error;
 
 	if (!suspend_ops)
@@ -207,7 +221,10 @@ int suspend_devices_and_enter(suspend_state_t state)
 	}
 	suspend_console();
 	suspend_test_start();
+	start = pm_profile_start();
 	error = dpm_suspend_start(PMSG_SUSPEND);
+	pm_profile_record(PM_PROFILE_STAGE, "dpm_suspend_start", NULL, start,
+			  error);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to suspend\n");
 		goto Recover_platform;
@@ -220,7 +237,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 
  Resume_devices:
 	suspend_test_start();
+	start = pm_profile_start();
 	dpm_resume_end(PMSG_RESUME);
+	pm_profile_record(PM_PROFILE_STAGE, "dpm_resume_end", NULL, start, 0);
 	suspend_test_finish("resume devices");
 	resume_console();
  Close:
@@ -257,6 +276,8 @@ static void suspend_finish(void)
  *	happen when we wake up.
  *	Then, do the setup for suspend, enter the state, and cleaup (after
  *	we've woken up).
+ *
+ *	__enter_state() lets pm_suspend_nosync() skip the sys_sync().
  */
 
 #ifdef CONFIG_CPU_FREQ
@@ -267,8 +288,9 @@ extern bool g_dvfs_fix_lock_limit;
 extern int s5pc110_pm_target(unsigned int target_freq);
 extern unsigned int s5pc110_getspeed(unsigned int cpu);
 #endif
-int enter_state(suspend_state_t state)
+int __enter_state(suspend_state_t state, bool sync)
 {
+	u64 start;
 	int error;
 	struct cpufreq_policy policy;
 
@@ -310,12 +332,18 @@ int enter_state(suspend_state_t state)
 #endif
 #endif
 
-	printk(KERN_INFO "PM: Syncing filesystems ... ");
-	sys_sync();
-	printk("done.\n");
+	if (sync) {
+		printk(KERN_INFO "PM: Syncing filesystems ... ");
+		sys_sync();
+		printk("done.\n");
+	}
 
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
+	pm_profile_begin();
+	start = pm_profile_start();
 	error = suspend_prepare();
+	pm_profile_record(PM_PROFILE_STAGE, "suspend_prepare", NULL, start,
+			  error);
 	if (error)
 		goto Unlock;
 
@@ -327,7 +355,9 @@ int enter_state(suspend_state_t state)
 
  Finish:
 	pr_debug("PM: Finishing wakeup.\n");
+	start = pm_profile_start();
 	suspend_finish();
+	pm_profile_record(PM_PROFILE_STAGE, "suspend_finish", NULL, start, 0);
  Unlock:
 	mutex_unlock(&pm_mutex);
 #ifdef CONFIG_CPU_FREQ
@@ -352,6 +382,11 @@ int enter_state(suspend_state_t state)
 	return error;
 }
 
+int enter_state(suspend_state_t state)
+{
+	return __enter_state(state, true);
+}
+
 /**
  *	pm_suspend - Externally visible function for suspending system.
  *	@state:		Enumerated value of state to enter.
@@ -366,3 +401,17 @@ int pm_suspend(suspend_state_t state)
 	return -EINVAL;
 }
 EXPORT_SYMBOL(pm_suspend);
+
+/**
+ *	pm_suspend_nosync - pm_suspend() without the sys_sync().
+ *	@state:		Enumerated value of state to enter.
+ *
+ *	For callers that have already written back what they need to.
+ */
+int pm_suspend_nosync(suspend_state_t state)
+{
+	if (state > PM_SUSPEND_ON && state <= PM_SUSPEND_MAX)
+		return __enter_state(state, false);
+	return -EINVAL;
+}
+EXPORT_SYMBOL(pm_suspend_nosync);
@@ -14,6 +14,9 @@
  */
 
 #include <linux/module.h>
+#include <linux/dcache.h> /* full_name_hash */
+#include <linux/fs.h> /* sync_filesystems_bounded */
+#include <linux/math64.h>
 #include <linux/platform_device.h>
 #include <linux/rtc.h>
 #include <linux/suspend.h>
@@ -22,6 +25,7 @@
 #ifdef CONFIG_WAKELOCK_STAT
 #include <linux/proc_fs.h>
 #endif
+#include <trace/events/power.h>
 #include "power.h"
 #ifdef CONFIG_SVNET_WHITELIST
 #include <linux/delay.h>
@@ -42,11 +46,22 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 #define WAKE_LOCK_INITIALIZED            (1U << 8)
 #define WAKE_LOCK_ACTIVE                 (1U << 9)
 #define WAKE_LOCK_AUTO_EXPIRE            (1U << 10)
-#define WAKE_LOCK_PREVENTING_SUSPEND     (1U << 11)
+
+#define WAKE_LOCK_HASH_BITS              (6)
+#define WAKE_LOCK_HASH_SIZE              (1U << WAKE_LOCK_HASH_BITS)
 
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/*
+ * The active locks of each type are also split by kind, so has_wake_lock()
+ * does not have to walk them: the ones without a timeout are only counted,
+ * the ones with a timeout are kept in a tree ordered by expiry.
+ */
+static int active_no_expire_count[WAKE_LOCK_TYPE_COUNT];
+static struct rb_root expire_tree[WAKE_LOCK_TYPE_COUNT];
+/* all initialized locks by name, for has_wake_lock_internal() */
+static struct hlist_head wake_lock_hash[WAKE_LOCK_HASH_SIZE];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct workqueue_struct *sync_work_queue;
@@ -57,7 +72,8 @@ static struct wake_lock unknown_wakeup;
 
 #ifdef CONFIG_WAKELOCK_STAT
 static struct wake_lock deleted_wake_locks;
-static ktime_t last_sleep_time_update;
+/* when main_wake_lock was last released, see add_prevent_suspend_time */
+static ktime_t suspend_wait_start;
 static int wait_for_wakeup;
 
 int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
@@ -87,15 +103,77 @@ int get_expired_time(struct wake_lock *lock, ktime_t *expire_time)
 }
 
 
+/*
+ * Time an active lock has kept the system from suspending up to @end: the
+ * part of its active period since main_wake_lock was released.  Computed
+ * when needed instead of being brought up to date for every lock on each
+ * wake lock event.
+ */
+static ktime_t prevent_suspend_delta(struct wake_lock *lock, ktime_t end)
+{
+	ktime_t start = lock->stat.last_time;
+
+	if ((lock->flags & WAKE_LOCK_TYPE_MASK) != WAKE_LOCK_SUSPEND ||
+	    lock == &main_wake_lock || wake_lock_active(&main_wake_lock))
+		return ktime_set(0, 0);
+	if (start.tv64 < suspend_wait_start.tv64)
+		start = suspend_wait_start;
+	if (end.tv64 <= start.tv64)
+		return ktime_set(0, 0);
+	return ktime_sub(end, start);
+}
+
+/*
+ * The counters of a lock are added to under its own lock->stat.lock rather
+ * than list_lock. wake_unlock() works out what a release adds while it holds
+ * list_lock, in a struct wake_lock_stat_delta, and adds it once list_lock
+ * is dropped; the additions commute, so it does not matter in which order
+ * they land. last_time belongs to the lock's state and stays under
+ * list_lock.
+ */
+struct wake_lock_stat_delta {
+	int valid;
+	int expired;
+	ktime_t duration;
+	ktime_t prevent_suspend_time;
+};
+
+static void wake_lock_stat_add(struct wake_lock *lock,
+			       struct wake_lock_stat_delta *d)
+{
+	unsigned long irqflags;
+
+	if (!d->valid)
+		return;
+	write_seqlock_irqsave(&lock->stat.lock, irqflags);
+	lock->stat.count++;
+	if (d->expired)
+		lock->stat.expire_count++;
+	lock->stat.total_time = ktime_add(lock->stat.total_time, d->duration);
+	if (ktime_to_ns(d->duration) > ktime_to_ns(lock->stat.max_time))
+		lock->stat.max_time = d->duration;
+	lock->stat.prevent_suspend_time = ktime_add(
+		lock->stat.prevent_suspend_time, d->prevent_suspend_time);
+	write_sequnlock_irqrestore(&lock->stat.lock, irqflags);
+}
+
 static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 {
-	int lock_count = lock->stat.count;
-	int expire_count = lock->stat.expire_count;
+	int lock_count, expire_count, wakeup_count;
 	ktime_t active_time = ktime_set(0, 0);
-	ktime_t total_time = lock->stat.total_time;
-	ktime_t max_time = lock->stat.max_time;
+	ktime_t total_time, max_time, prevent_suspend_time;
+	unsigned seq;
+
+	do {
+		seq = read_seqbegin(&lock->stat.lock);
+		lock_count = lock->stat.count;
+		expire_count = lock->stat.expire_count;
+		wakeup_count = lock->stat.wakeup_count;
+		total_time = lock->stat.total_time;
+		max_time = lock->stat.max_time;
+		prevent_suspend_time = lock->stat.prevent_suspend_time;
+	} while (read_seqretry(&lock->stat.lock, seq));
 
-	ktime_t prevent_suspend_time = lock->stat.prevent_suspend_time;
 	if (lock->flags & WAKE_LOCK_ACTIVE) {
 		ktime_t now, add_time;
 		int expired = get_expired_time(lock, &now);
@@ -108,9 +186,8 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 		else
 			expire_count++;
 		total_time = ktime_add(total_time, add_time);
-		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND)
-			prevent_suspend_time = ktime_add(prevent_suspend_time,
-					ktime_sub(now, last_sleep_time_update));
+		prevent_suspend_time = ktime_add(prevent_suspend_time,
+					prevent_suspend_delta(lock, now));
 		if (add_time.tv64 > max_time.tv64)
 			max_time = add_time;
 	}
@@ -118,7 +195,7 @@ static int print_lock_stat(struct seq_file *m, struct wake_lock *lock)
 	return seq_printf(m,
 		     "\"%s\"\t%d\t%d\t%d\t%lld\t%lld\t%lld\t%lld\t%lld\n",
 		     lock->name, lock_count, expire_count,
-		     lock->stat.wakeup_count, ktime_to_ns(active_time),
+		     wakeup_count, ktime_to_ns(active_time),
 		     ktime_to_ns(total_time),
 		     ktime_to_ns(prevent_suspend_time), ktime_to_ns(max_time),
 		     ktime_to_ns(lock->stat.last_time));
@@ -145,65 +222,97 @@ static int wakelock_stats_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
-static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
+/*
+ * Work out what releasing @lock at @now adds to its stats, for
+ * wake_lock_stat_add() to add once list_lock has been dropped.
+ */
+static void wake_unlock_stat_locked(struct wake_lock *lock, int expired,
+				    ktime_t now, struct wake_lock_stat_delta *d)
 {
-	ktime_t duration;
-	ktime_t now;
+	ktime_t end;
+
+	d->valid = 0;
 	if (!(lock->flags & WAKE_LOCK_ACTIVE))
 		return;
-	if (get_expired_time(lock, &now))
+	if (get_expired_time(lock, &end))
 		expired = 1;
 	else
-		now = ktime_get();
-	lock->stat.count++;
-	if (expired)
-		lock->stat.expire_count++;
-	duration = ktime_sub(now, lock->stat.last_time);
-	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
-	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
-		lock->stat.max_time = duration;
-	lock->stat.last_time = ktime_get();
-	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-		duration = ktime_sub(now, last_sleep_time_update);
-		lock->stat.prevent_suspend_time = ktime_add(
-			lock->stat.prevent_suspend_time, duration);
-		lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
-	}
+		end = now;
+	d->valid = 1;
+	d->expired = expired;
+	d->duration = ktime_sub(end, lock->stat.last_time);
+	d->prevent_suspend_time = prevent_suspend_delta(lock, end);
+	lock->stat.last_time = now;
 }
 
-static void update_sleep_wait_stats_locked(int done)
+/*
+ * main_wake_lock is about to be taken: close the suspend wait period for
+ * every lock still active.  Only main_wake_lock transitions walk the list.
+ */
+static void update_sleep_wait_stats_locked(void)
 {
 	struct wake_lock *lock;
-	ktime_t now, etime, elapsed, add;
-	int expired;
+	ktime_t now, etime;
 
 	now = ktime_get();
-	elapsed = ktime_sub(now, last_sleep_time_update);
 	list_for_each_entry(lock, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
-		expired = get_expired_time(lock, &etime);
-		if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
-			if (expired)
-				add = ktime_sub(etime, last_sleep_time_update);
-			else
-				add = elapsed;
-			lock->stat.prevent_suspend_time = ktime_add(
-				lock->stat.prevent_suspend_time, add);
-		}
-		if (done || expired)
-			lock->flags &= ~WAKE_LOCK_PREVENTING_SUSPEND;
-		else
-			lock->flags |= WAKE_LOCK_PREVENTING_SUSPEND;
+		if (!get_expired_time(lock, &etime))
+			etime = now;
+		write_seqlock(&lock->stat.lock);
+		lock->stat.prevent_suspend_time = ktime_add(
+			lock->stat.prevent_suspend_time,
+			prevent_suspend_delta(lock, etime));
+		write_sequnlock(&lock->stat.lock);
 	}
-	last_sleep_time_update = now;
 }
 #endif
 
+static inline struct hlist_head *wake_lock_hash_head(const char *name)
+{
+	unsigned int hash = full_name_hash(name, strlen(name));
+
+	return &wake_lock_hash[hash & (WAKE_LOCK_HASH_SIZE - 1)];
+}
+
+/* Take an active lock out of the expire tree or the no-expire count */
+static void wake_lock_dequeue_locked(struct wake_lock *lock, int type)
+{
+	if (!(lock->flags & WAKE_LOCK_ACTIVE))
+		return;
+	if (lock->flags & WAKE_LOCK_AUTO_EXPIRE)
+		rb_erase(&lock->expire_node, &expire_tree[type]);
+	else
+		active_no_expire_count[type]--;
+}
+
+static void wake_lock_enqueue_expire_locked(struct wake_lock *lock, int type)
+{
+	struct rb_node **p = &expire_tree[type].rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct wake_lock, expire_node);
+		if (time_before(lock->expires, entry->expires))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&lock->expire_node, parent, p);
+	rb_insert_color(&lock->expire_node, &expire_tree[type]);
+}
+
 
 static void expire_wake_lock(struct wake_lock *lock)
 {
 #ifdef CONFIG_WAKELOCK_STAT
-	wake_unlock_stat_locked(lock, 1);
+	struct wake_lock_stat_delta d;
+
+	wake_unlock_stat_locked(lock, 1, ktime_get(), &d);
+	wake_lock_stat_add(lock, &d);
 #endif
+	wake_lock_dequeue_locked(lock, lock->flags & WAKE_LOCK_TYPE_MASK);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -236,21 +345,25 @@ static void print_active_locks(int type)
 
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct wake_lock *lock;
+	struct rb_node *node;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	if (active_no_expire_count[type])
+		return -1;
+
+	/* expire from the front of the tree; the last one expires latest */
+	while ((node = rb_first(&expire_tree[type]))) {
+		lock = rb_entry(node, struct wake_lock, expire_node);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	node = rb_last(&expire_tree[type]);
+	if (!node)
+		return 0;
+	lock = rb_entry(node, struct wake_lock, expire_node);
+	return lock->expires - jiffies;
 }
 
 long has_wake_lock(int type)
@@ -265,10 +378,58 @@ long has_wake_lock(int type)
 	return ret;
 }
 
+/*
+ * With suspend_sync_bounded set, suspend() does not sys_sync() but only
+ * starts writeback of data dirty for longer than suspend_sync_age_ms, for at
+ * most suspend_sync_budget_ms, and gives up on the attempt if a suspend
+ * wake lock is taken meanwhile. Newer dirty pages stay in RAM across
+ * suspend and are written by the flusher threads after resume.
+ */
+static int suspend_sync_bounded;
+module_param_named(suspend_sync_bounded, suspend_sync_bounded, int,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
+static unsigned int suspend_sync_age_ms = 2000;
+module_param_named(suspend_sync_age_ms, suspend_sync_age_ms, uint,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
+static unsigned int suspend_sync_budget_ms = 50;
+module_param_named(suspend_sync_budget_ms, suspend_sync_budget_ms, uint,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
+
+static int suspend_sync_abort(void)
+{
+	return has_wake_lock(WAKE_LOCK_SUSPEND) != 0;
+}
+
+static int suspend_sync(int bounded)
+{
+	ktime_t start = ktime_get();
+	long pages = 0;
+	u64 duration_us;
+	int ret = 0;
+
+	if (bounded)
+		ret = sync_filesystems_bounded(
+			jiffies - msecs_to_jiffies(suspend_sync_age_ms),
+			jiffies + msecs_to_jiffies(suspend_sync_budget_ms),
+			suspend_sync_abort, &pages);
+	else
+		sys_sync();
+
+	duration_us = div_u64(ktime_to_ns(ktime_sub(ktime_get(), start)),
+			      NSEC_PER_USEC);
+	trace_suspend_sync(bounded, pages, duration_us, ret);
+	if (debug_mask & DEBUG_SUSPEND)
+		pr_info("suspend: sync%s took %llu us, %ld pages, ret %d\n",
+			bounded ? " (bounded)" : "",
+			(unsigned long long)duration_us, pages, ret);
+	return ret;
+}
+
 static void suspend(struct work_struct *work)
 {
 	int ret;
 	int entry_event_num;
+	int bounded = suspend_sync_bounded;
 
 	if (has_wake_lock(WAKE_LOCK_SUSPEND)) {
 		if (debug_mask & DEBUG_SUSPEND)
@@ -293,10 +454,17 @@ static void suspend(struct work_struct *work)
 #endif /* CONFIG_SVNET_WHITELIST */
 
 	entry_event_num = current_event_num;
-	sys_sync();
+	if (suspend_sync(bounded) == -EBUSY) {
+		if (debug_mask & DEBUG_SUSPEND)
+			pr_info("suspend: abort suspend during sync\n");
+		return;
+	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("suspend: enter suspend\n");
-	ret = pm_suspend(requested_suspend_state);
+	if (bounded)
+		ret = pm_suspend_nosync(requested_suspend_state);
+	else
+		ret = pm_suspend(requested_suspend_state);
 	if (debug_mask & DEBUG_EXIT_SUSPEND) {
 		struct timespec ts;
 		struct rtc_time tm;
@@ -367,6 +535,7 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_init name=%s\n", lock->name);
 #ifdef CONFIG_WAKELOCK_STAT
+	seqlock_init(&lock->stat.lock);
 	lock->stat.count = 0;
 	lock->stat.expire_count = 0;
 	lock->stat.wakeup_count = 0;
@@ -378,8 +547,10 @@ void wake_lock_init(struct wake_lock *lock, int type, const char *name)
 	lock->flags = (type & WAKE_LOCK_TYPE_MASK) | WAKE_LOCK_INITIALIZED;
 
 	INIT_LIST_HEAD(&lock->link);
+	RB_CLEAR_NODE(&lock->expire_node);
 	spin_lock_irqsave(&list_lock, irqflags);
 	list_add(&lock->link, &inactive_locks);
+	hlist_add_head(&lock->hash_node, wake_lock_hash_head(lock->name));
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_lock_init);
@@ -390,9 +561,13 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
-	lock->flags &= ~WAKE_LOCK_INITIALIZED;
+	wake_lock_dequeue_locked(lock, lock->flags & WAKE_LOCK_TYPE_MASK);
+	lock->flags &= ~(WAKE_LOCK_INITIALIZED | WAKE_LOCK_ACTIVE |
+			 WAKE_LOCK_AUTO_EXPIRE);
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
+		/* the owner is done with it, nobody else adds to its stats */
+		write_seqlock(&deleted_wake_locks.stat.lock);
 		deleted_wake_locks.stat.count += lock->stat.count;
 		deleted_wake_locks.stat.expire_count += lock->stat.expire_count;
 		deleted_wake_locks.stat.total_time =
@@ -404,9 +579,11 @@ void wake_lock_destroy(struct wake_lock *lock)
 		deleted_wake_locks.stat.max_time =
 			ktime_add(deleted_wake_locks.stat.max_time,
 				  lock->stat.max_time);
+		write_sequnlock(&deleted_wake_locks.stat.lock);
 	}
 #endif
 	list_del(&lock->link);
+	hlist_del(&lock->hash_node);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_lock_destroy);
@@ -417,6 +594,11 @@ static void wake_lock_internal(
 	int type;
 	unsigned long irqflags;
 	long expire_in;
+#ifdef CONFIG_WAKELOCK_STAT
+	/* read the clock before turning irqs off */
+	ktime_t now = ktime_get();
+	struct wake_lock_stat_delta d = { .valid = 0 };
+#endif
 
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
@@ -427,20 +609,23 @@ static void wake_lock_internal(
 		if (debug_mask & DEBUG_WAKEUP)
 			pr_info("wakeup wake lock: %s\n", lock->name);
 		wait_for_wakeup = 0;
+		write_seqlock(&lock->stat.lock);
 		lock->stat.wakeup_count++;
+		write_sequnlock(&lock->stat.lock);
 	}
 	if ((lock->flags & WAKE_LOCK_AUTO_EXPIRE) &&
-	    (long)(lock->expires - jiffies) <= 0) {
-		wake_unlock_stat_locked(lock, 0);
-		lock->stat.last_time = ktime_get();
-	}
+	    (long)(lock->expires - jiffies) <= 0)
+		wake_unlock_stat_locked(lock, 0, now, &d);
 #endif
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
-		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
-		lock->stat.last_time = ktime_get();
+		if (lock == &main_wake_lock)
+			update_sleep_wait_stats_locked();
+		lock->stat.last_time = now;
 #endif
 	}
+	wake_lock_dequeue_locked(lock, type);
+	lock->flags |= WAKE_LOCK_ACTIVE;
 	list_del(&lock->link);
 	if (has_timeout) {
 		if (debug_mask & DEBUG_WAKE_LOCK)
@@ -450,21 +635,17 @@ static void wake_lock_internal(
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
 		list_add_tail(&lock->link, &active_wake_locks[type]);
+		wake_lock_enqueue_expire_locked(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
+		active_no_expire_count[type]++;
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
-#ifdef CONFIG_WAKELOCK_STAT
-		if (lock == &main_wake_lock)
-			update_sleep_wait_stats_locked(1);
-		else if (!wake_lock_active(&main_wake_lock))
-			update_sleep_wait_stats_locked(0);
-#endif
 		if (has_timeout)
 			expire_in = has_wake_lock_locked(type);
 		else
@@ -484,6 +665,9 @@ static void wake_lock_internal(
 		}
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
+#ifdef CONFIG_WAKELOCK_STAT
+	wake_lock_stat_add(lock, &d);
+#endif
 }
 
 void wake_lock(struct wake_lock *lock)
@@ -502,13 +686,19 @@ void wake_unlock(struct wake_lock *lock)
 {
 	int type;
 	unsigned long irqflags;
+#ifdef CONFIG_WAKELOCK_STAT
+	ktime_t now = ktime_get();
+	struct wake_lock_stat_delta d;
+#endif
+
 	spin_lock_irqsave(&list_lock, irqflags);
 	type = lock->flags & WAKE_LOCK_TYPE_MASK;
 #ifdef CONFIG_WAKELOCK_STAT
-	wake_unlock_stat_locked(lock, 0);
+	wake_unlock_stat_locked(lock, 0, now, &d);
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	wake_lock_dequeue_locked(lock, type);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
@@ -531,11 +721,14 @@ void wake_unlock(struct wake_lock *lock)
 			if (debug_mask & DEBUG_SUSPEND)
 				print_active_locks(WAKE_LOCK_SUSPEND);
 #ifdef CONFIG_WAKELOCK_STAT
-			update_sleep_wait_stats_locked(0);
+			suspend_wait_start = now;
 #endif
 		}
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
+#ifdef CONFIG_WAKELOCK_STAT
+	wake_lock_stat_add(lock, &d);
+#endif
 }
 EXPORT_SYMBOL(wake_unlock);
 
@@ -563,25 +756,19 @@ static int has_wake_lock_internal(const char *name)
 {
 	int ret = 0;
 	unsigned long irqflags;
-	struct wake_lock *lock, *n;
+	struct wake_lock *lock;
+	struct hlist_node *pos;
 
 	spin_lock_irqsave(&list_lock, irqflags);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[WAKE_LOCK_SUSPEND], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout > 0) {
-				if (strcmp(lock->name, name) == 0) {
-					ret = 1;
-					spin_unlock_irqrestore(&list_lock, irqflags);
-					return ret;
-				}
-			}
-		} else {
-			if (strcmp(lock->name, name) == 0) {
-				ret = 1;
-				spin_unlock_irqrestore(&list_lock, irqflags);
-				return ret;
-			}
+	hlist_for_each_entry(lock, pos, wake_lock_hash_head(name), hash_node) {
+		if ((lock->flags & WAKE_LOCK_TYPE_MASK) != WAKE_LOCK_SUSPEND ||
+		    !(lock->flags & WAKE_LOCK_ACTIVE) ||
+		    strcmp(lock->name, name))
+			continue;
+		if (!(lock->flags & WAKE_LOCK_AUTO_EXPIRE) ||
+		    (long)(lock->expires - jiffies) > 0) {
+			ret = 1;
+			break;
 		}
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
@@ -606,8 +793,12 @@ static int __init wakelocks_init(void)
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		expire_tree[i] = RB_ROOT;
+	}
+	for (i = 0; i < ARRAY_SIZE(wake_lock_hash); i++)
+		INIT_HLIST_HEAD(&wake_lock_hash[i]);
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -53,6 +53,7 @@
 #include <linux/timer.h>
 #include <linux/rcupdate.h>
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
 #include <linux/cpuset.h>
 #include <linux/percpu.h>
 #include <linux/kthread.h>
@@ -230,6 +231,81 @@ static void destroy_rt_bandwidth(struct rt_bandwidth *rt_b)
 }
 #endif
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * CPU quota of a group of SCHED_OTHER tasks: every period the group may
+ * run for quota ns in total, over all cpus.
+ */
+struct cfs_bandwidth {
+	/* nests inside the rq lock: */
+	spinlock_t		lock;
+	ktime_t			period;
+	u64			quota;		/* RUNTIME_INF: no limit */
+	u64			runtime;	/* left in this period */
+	int			idle;		/* none handed out this period */
+	struct hrtimer		period_timer;
+};
+
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun);
+
+static enum hrtimer_restart sched_cfs_period_timer(struct hrtimer *timer)
+{
+	struct cfs_bandwidth *cfs_b =
+		container_of(timer, struct cfs_bandwidth, period_timer);
+	ktime_t now;
+	int overrun;
+	int idle = 0;
+
+	for (;;) {
+		now = hrtimer_cb_get_time(timer);
+		overrun = hrtimer_forward(timer, now, cfs_b->period);
+
+		if (!overrun)
+			break;
+
+		idle = do_sched_cfs_period_timer(cfs_b, overrun);
+	}
+
+	return idle ? HRTIMER_NORESTART : HRTIMER_RESTART;
+}
+
+static void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	spin_lock_init(&cfs_b->lock);
+	cfs_b->period = ns_to_ktime(100 * NSEC_PER_MSEC);
+	cfs_b->quota = RUNTIME_INF;
+	cfs_b->runtime = RUNTIME_INF;
+
+	hrtimer_init(&cfs_b->period_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	cfs_b->period_timer.function = sched_cfs_period_timer;
+}
+
+/* Called with cfs_b->lock held, when the group draws on its quota. */
+static void start_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	ktime_t now;
+
+	while (!hrtimer_active(&cfs_b->period_timer)) {
+		unsigned long delta;
+		ktime_t soft, hard;
+
+		now = hrtimer_cb_get_time(&cfs_b->period_timer);
+		hrtimer_forward(&cfs_b->period_timer, now, cfs_b->period);
+
+		soft = hrtimer_get_softexpires(&cfs_b->period_timer);
+		hard = hrtimer_get_expires(&cfs_b->period_timer);
+		delta = ktime_to_ns(ktime_sub(hard, soft));
+		__hrtimer_start_range_ns(&cfs_b->period_timer, soft, delta,
+				HRTIMER_MODE_ABS_PINNED, 0);
+	}
+}
+
+static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
+{
+	hrtimer_cancel(&cfs_b->period_timer);
+}
+#endif
+
 /*
  * sched_domains_mutex serializes calls to arch_init_sched_domains,
  * detach_destroy_domains and partition_sched_domains.
@@ -260,6 +336,14 @@ struct task_group {
 	/* runqueue "owned" by this group on each cpu */
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
+#ifdef CONFIG_CFS_BANDWIDTH
+	struct cfs_bandwidth cfs_bandwidth;
+#endif
+#endif
+
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_CPU_FREQ)
+	/* cpu.max_freq in kHz, 0 if none */
+	unsigned int max_freq;
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -448,6 +532,12 @@ struct cfs_rq {
 	 */
 	unsigned long rq_weight;
 #endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	int runtime_enabled;
+	/* off the parent cfs_rq until the period timer refills the quota */
+	int throttled;
+	s64 runtime_remaining;
+#endif
 #endif
 };
 
@@ -569,6 +659,10 @@ struct rq {
 	struct task_struct *curr, *idle;
 	unsigned long next_balance;
 	struct mm_struct *prev_mm;
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_CPU_FREQ)
+	/* highest task_freq_cap() since the last sched_get_freq_cap() */
+	unsigned int freq_cap;
+#endif
 
 	u64 clock;
 
@@ -1830,6 +1924,57 @@ static void update_sysctl(void);
 #define for_each_class(class) \
    for (class = sched_class_highest; class; class = class->next)
 
+#if defined(CONFIG_CGROUP_SCHED) && defined(CONFIG_CPU_FREQ)
+/*
+ * Frequency hints: cpu.max_freq of a task's cpu cgroup is the highest
+ * speed it wants the cpu to go to on its behalf.  Each rq remembers the
+ * highest hint of the user tasks it switched to or ticked in since the
+ * cpufreq governor last looked, so a governor that honours it only raises
+ * the speed past the hint of a background group when something else ran
+ * as well.  Kernel threads, the governor's own worker among them, do not
+ * count.
+ */
+static inline unsigned int task_freq_cap(struct task_struct *p)
+{
+	unsigned int cap = task_group(p)->max_freq;
+
+	return cap ? cap : UINT_MAX;
+}
+
+static inline void sched_note_freq_cap(struct rq *rq, struct task_struct *next)
+{
+	if (next->mm && !(next->flags & PF_KTHREAD))
+		rq->freq_cap = max(rq->freq_cap, task_freq_cap(next));
+}
+
+/**
+ * sched_get_freq_cap - highest frequency hint of the tasks that ran on @cpu
+ * @cpu: the cpu
+ *
+ * Returns a frequency in kHz, or UINT_MAX if any task without a hint ran
+ * or no user task ran at all, and starts a new window.  The window does not
+ * start out with the current task; it is counted again at its next tick.
+ */
+unsigned int sched_get_freq_cap(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long flags;
+	unsigned int cap;
+
+	spin_lock_irqsave(&rq->lock, flags);
+	cap = rq->freq_cap;
+	rq->freq_cap = 0;
+	spin_unlock_irqrestore(&rq->lock, flags);
+
+	return cap ? cap : UINT_MAX;
+}
+EXPORT_SYMBOL_GPL(sched_get_freq_cap);
+#else
+static inline void sched_note_freq_cap(struct rq *rq, struct task_struct *next)
+{
+}
+#endif
+
 static void inc_nr_running(struct rq *rq)
 {
 	rq->nr_running++;
@@ -5042,6 +5187,7 @@ void account_user_time(struct task_struct *p, cputime_t cputime,
 		cpustat->user = cputime64_add(cpustat->user, tmp);
 
 	cpuacct_update_stats(p, CPUACCT_STAT_USER, cputime);
+	cpufreq_stats_uid_account(p, cputime);
 	/* Account for user time used */
 	acct_update_integrals(p);
 }
@@ -5104,6 +5250,7 @@ void account_system_time(struct task_struct *p, int hardirq_offset,
 		cpustat->system = cputime64_add(cpustat->system, tmp);
 
 	cpuacct_update_stats(p, CPUACCT_STAT_SYSTEM, cputime);
+	cpufreq_stats_uid_account(p, cputime);
 
 	/* Account for system time used */
 	acct_update_integrals(p);
@@ -5257,6 +5404,7 @@ void scheduler_tick(void)
 	update_rq_clock(rq);
 	update_cpu_load(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
+	sched_note_freq_cap(rq, curr);
 	spin_unlock(&rq->lock);
 
 	perf_event_task_tick(curr, cpu);
@@ -5476,6 +5624,7 @@ need_resched_nonpreemptible:
 	if (likely(prev != next)) {
 		sched_info_switch(prev, next);
 		perf_event_task_sched_out(prev, next, cpu);
+		sched_note_freq_cap(rq, next);
 
 		rq->nr_switches++;
 		rq->curr = next;
@@ -9473,6 +9622,10 @@ void __init sched_init(void)
 #endif /* CONFIG_USER_SCHED */
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	init_cfs_bandwidth(&init_task_group.cfs_bandwidth);
+#endif
+
 #ifdef CONFIG_GROUP_SCHED
 	list_add(&init_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&init_task_group.children);
@@ -9789,6 +9942,10 @@ static void free_fair_sched_group(struct task_group *tg)
 {
 	int i;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	destroy_cfs_bandwidth(&tg->cfs_bandwidth);
+#endif
+
 	for_each_possible_cpu(i) {
 		if (tg->cfs_rq)
 			kfree(tg->cfs_rq[i]);
@@ -9808,6 +9965,11 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 	struct rq *rq;
 	int i;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+	/* before anything can fail: free_fair_sched_group() cancels it */
+	init_cfs_bandwidth(&tg->cfs_bandwidth);
+#endif
+
 	tg->cfs_rq = kzalloc(sizeof(cfs_rq) * nr_cpu_ids, GFP_KERNEL);
 	if (!tg->cfs_rq)
 		goto err;
@@ -10160,6 +10322,96 @@ unsigned long sched_group_shares(struct task_group *tg)
 }
 #endif
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static DEFINE_MUTEX(cfs_constraints_mutex);
+
+static const u64 min_cfs_period = 1 * NSEC_PER_MSEC;
+static const u64 max_cfs_period = 1 * NSEC_PER_SEC;
+static const u64 min_cfs_quota = 1 * NSEC_PER_MSEC;
+
+static int tg_set_cfs_bandwidth(struct task_group *tg, u64 period, u64 quota)
+{
+	struct cfs_bandwidth *cfs_b = &tg->cfs_bandwidth;
+	int i, runtime_enabled = quota != RUNTIME_INF;
+
+	/*
+	 * The root group cannot be limited.
+	 */
+	if (!tg->se[0])
+		return -EINVAL;
+
+	if (period < min_cfs_period || period > max_cfs_period)
+		return -EINVAL;
+	if (quota < min_cfs_quota)
+		return -EINVAL;
+
+	mutex_lock(&cfs_constraints_mutex);
+	spin_lock_irq(&cfs_b->lock);
+	cfs_b->period = ns_to_ktime(period);
+	cfs_b->quota = quota;
+	cfs_b->runtime = quota;
+	spin_unlock_irq(&cfs_b->lock);
+
+	for_each_possible_cpu(i) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+		struct rq *rq = rq_of(cfs_rq);
+
+		spin_lock_irq(&rq->lock);
+		cfs_rq->runtime_enabled = runtime_enabled;
+		cfs_rq->runtime_remaining = 0;
+		if (cfs_rq_throttled(cfs_rq))
+			unthrottle_cfs_rq(cfs_rq);
+		spin_unlock_irq(&rq->lock);
+	}
+	mutex_unlock(&cfs_constraints_mutex);
+
+	return 0;
+}
+
+static int sched_group_set_cfs_quota(struct task_group *tg, long cfs_quota_us)
+{
+	u64 quota, period;
+
+	period = ktime_to_ns(tg->cfs_bandwidth.period);
+	quota = (u64)cfs_quota_us * NSEC_PER_USEC;
+	if (cfs_quota_us < 0)
+		quota = RUNTIME_INF;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long sched_group_cfs_quota(struct task_group *tg)
+{
+	u64 quota_us;
+
+	if (tg->cfs_bandwidth.quota == RUNTIME_INF)
+		return -1;
+
+	quota_us = tg->cfs_bandwidth.quota;
+	do_div(quota_us, NSEC_PER_USEC);
+	return quota_us;
+}
+
+static int sched_group_set_cfs_period(struct task_group *tg, long cfs_period_us)
+{
+	u64 quota, period;
+
+	period = (u64)cfs_period_us * NSEC_PER_USEC;
+	quota = tg->cfs_bandwidth.quota;
+
+	return tg_set_cfs_bandwidth(tg, period, quota);
+}
+
+static long sched_group_cfs_period(struct task_group *tg)
+{
+	u64 period_us;
+
+	period_us = ktime_to_ns(tg->cfs_bandwidth.period);
+	do_div(period_us, NSEC_PER_USEC);
+	return period_us;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 #ifdef CONFIG_RT_GROUP_SCHED
 /*
  * Ensure that the real time constraints are schedulable.
@@ -10549,6 +10801,49 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 }
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static int cpu_cfs_quota_write_s64(struct cgroup *cgrp, struct cftype *cftype,
+				   s64 cfs_quota_us)
+{
+	return sched_group_set_cfs_quota(cgroup_tg(cgrp), cfs_quota_us);
+}
+
+static s64 cpu_cfs_quota_read_s64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return sched_group_cfs_quota(cgroup_tg(cgrp));
+}
+
+static int cpu_cfs_period_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+				    u64 cfs_period_us)
+{
+	return sched_group_set_cfs_period(cgroup_tg(cgrp), cfs_period_us);
+}
+
+static u64 cpu_cfs_period_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return sched_group_cfs_period(cgroup_tg(cgrp));
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
+#ifdef CONFIG_CPU_FREQ
+static int cpu_max_freq_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+				  u64 max_freq)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+	if (tg == &init_task_group || max_freq > UINT_MAX)
+		return -EINVAL;
+
+	tg->max_freq = max_freq;
+	return 0;
+}
+
+static u64 cpu_max_freq_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return cgroup_tg(cgrp)->max_freq;
+}
+#endif /* CONFIG_CPU_FREQ */
+
 #ifdef CONFIG_RT_GROUP_SCHED
 static int cpu_rt_runtime_write(struct cgroup *cgrp, struct cftype *cft,
 				s64 val)
@@ -10581,6 +10876,25 @@ static struct cftype cpu_files[] = {
 		.write_u64 = cpu_shares_write_u64,
 	},
 #endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		.name = "cfs_quota_us",
+		.read_s64 = cpu_cfs_quota_read_s64,
+		.write_s64 = cpu_cfs_quota_write_s64,
+	},
+	{
+		.name = "cfs_period_us",
+		.read_u64 = cpu_cfs_period_read_u64,
+		.write_u64 = cpu_cfs_period_write_u64,
+	},
+#endif
+#ifdef CONFIG_CPU_FREQ
+	{
+		.name = "max_freq",
+		.read_u64 = cpu_max_freq_read_u64,
+		.write_u64 = cpu_max_freq_write_u64,
+	},
+#endif
 #ifdef CONFIG_RT_GROUP_SCHED
 	{
 		.name = "rt_runtime_us",
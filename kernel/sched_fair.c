@@ -492,6 +492,85 @@ __update_curr(struct cfs_rq *cfs_rq, struct sched_entity *curr,
 	update_min_vruntime(cfs_rq);
 }
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * CFS bandwidth control
+ *
+ * The cfs_rqs of a group with a quota draw on it in slices as they run.
+ * When a cfs_rq runs out and the group's quota for the period is used up,
+ * the cpu is rescheduled and put_prev_entity() throttles the cfs_rq: its
+ * group entity is dequeued from the parent, so nothing below it can be
+ * picked.  The period timer refills the quota and enqueues the entity
+ * again, as sched_rt_period_timer() does for throttled rt_rqs.
+ */
+#define CFS_BANDWIDTH_SLICE	(5 * NSEC_PER_MSEC)
+
+static inline int cfs_rq_throttled(struct cfs_rq *cfs_rq)
+{
+	return cfs_rq->throttled;
+}
+
+/* Called with the rq lock held and cfs_rq->runtime_remaining <= 0. */
+static void assign_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	struct cfs_bandwidth *cfs_b = &cfs_rq->tg->cfs_bandwidth;
+	u64 amount, want = CFS_BANDWIDTH_SLICE - cfs_rq->runtime_remaining;
+
+	spin_lock(&cfs_b->lock);
+	if (cfs_b->quota == RUNTIME_INF) {
+		amount = want;
+	} else {
+		start_cfs_bandwidth(cfs_b);
+		amount = min(cfs_b->runtime, want);
+		cfs_b->runtime -= amount;
+		cfs_b->idle = 0;
+	}
+	spin_unlock(&cfs_b->lock);
+
+	cfs_rq->runtime_remaining += amount;
+}
+
+static void account_cfs_rq_runtime(struct cfs_rq *cfs_rq,
+				   unsigned long delta_exec)
+{
+	if (!cfs_rq->runtime_enabled)
+		return;
+
+	cfs_rq->runtime_remaining -= delta_exec;
+	if (cfs_rq->runtime_remaining > 0)
+		return;
+
+	assign_cfs_rq_runtime(cfs_rq);
+	if (cfs_rq->runtime_remaining <= 0)
+		resched_task(rq_of(cfs_rq)->curr);
+}
+
+/* Is any cfs_rq between @se and the root throttled? */
+static int throttled_hierarchy(struct sched_entity *se)
+{
+	for_each_sched_entity(se) {
+		if (cfs_rq_throttled(cfs_rq_of(se)))
+			return 1;
+	}
+	return 0;
+}
+#else
+static inline int cfs_rq_throttled(struct cfs_rq *cfs_rq)
+{
+	return 0;
+}
+
+static inline void account_cfs_rq_runtime(struct cfs_rq *cfs_rq,
+					  unsigned long delta_exec)
+{
+}
+
+static inline int throttled_hierarchy(struct sched_entity *se)
+{
+	return 0;
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 static void update_curr(struct cfs_rq *cfs_rq)
 {
 	struct sched_entity *curr = cfs_rq->curr;
@@ -512,6 +591,7 @@ static void update_curr(struct cfs_rq *cfs_rq)
 
 	__update_curr(cfs_rq, curr, delta_exec);
 	curr->exec_start = now;
+	account_cfs_rq_runtime(cfs_rq, delta_exec);
 
 	if (entity_is_task(curr)) {
 		struct task_struct *curtask = task_of(curr);
@@ -900,6 +980,98 @@ static struct sched_entity *pick_next_entity(struct cfs_rq *cfs_rq)
 	return se;
 }
 
+#ifdef CONFIG_CFS_BANDWIDTH
+static void throttle_cfs_rq(struct cfs_rq *cfs_rq)
+{
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq_of(cfs_rq))];
+
+	for_each_sched_entity(se) {
+		struct cfs_rq *qcfs_rq = cfs_rq_of(se);
+
+		if (!se->on_rq)
+			break;
+		dequeue_entity(qcfs_rq, se, 1);
+		/* Don't dequeue parent if it has other entities besides us */
+		if (qcfs_rq->load.weight)
+			break;
+	}
+
+	cfs_rq->throttled = 1;
+}
+
+static void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
+{
+	struct rq *rq = rq_of(cfs_rq);
+	struct sched_entity *se = cfs_rq->tg->se[cpu_of(rq)];
+
+	cfs_rq->throttled = 0;
+	if (!cfs_rq->load.weight)
+		return;
+
+	update_rq_clock(rq);
+	for_each_sched_entity(se) {
+		struct cfs_rq *qcfs_rq = cfs_rq_of(se);
+
+		if (se->on_rq)
+			break;
+		enqueue_entity(qcfs_rq, se, 1);
+		if (cfs_rq_throttled(qcfs_rq))
+			break;
+	}
+
+	/* the cpu may have gone idle while we were throttled */
+	if (rq->curr == rq->idle && rq->cfs.nr_running)
+		resched_task(rq->curr);
+}
+
+static void check_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+	if (cfs_rq->runtime_enabled && cfs_rq->runtime_remaining <= 0 &&
+	    !cfs_rq_throttled(cfs_rq))
+		throttle_cfs_rq(cfs_rq);
+}
+
+static int do_sched_cfs_period_timer(struct cfs_bandwidth *cfs_b, int overrun)
+{
+	struct task_group *tg =
+		container_of(cfs_b, struct task_group, cfs_bandwidth);
+	int i, idle, throttled = 0;
+
+	spin_lock(&cfs_b->lock);
+	if (cfs_b->quota == RUNTIME_INF) {
+		spin_unlock(&cfs_b->lock);
+		return 1;
+	}
+	/* unused quota does not carry over */
+	cfs_b->runtime = cfs_b->quota;
+	idle = cfs_b->idle;
+	cfs_b->idle = 1;
+	spin_unlock(&cfs_b->lock);
+
+	for_each_cpu(i, cpu_online_mask) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+		struct rq *rq = rq_of(cfs_rq);
+
+		spin_lock(&rq->lock);
+		if (cfs_rq_throttled(cfs_rq)) {
+			assign_cfs_rq_runtime(cfs_rq);
+			if (cfs_rq->runtime_remaining > 0)
+				unthrottle_cfs_rq(cfs_rq);
+			else
+				throttled = 1;
+		}
+		spin_unlock(&rq->lock);
+	}
+
+	/* stop the timer once the group neither runs nor waits for quota */
+	return idle && !throttled;
+}
+#else
+static inline void check_cfs_rq_runtime(struct cfs_rq *cfs_rq)
+{
+}
+#endif /* CONFIG_CFS_BANDWIDTH */
+
 static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 {
 	/*
@@ -908,6 +1080,7 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 	 */
 	if (prev->on_rq)
 		update_curr(cfs_rq);
+	check_cfs_rq_runtime(cfs_rq);
 
 	check_spread(cfs_rq, prev);
 	if (prev->on_rq) {
@@ -1022,6 +1195,9 @@ static void enqueue_task_fair(struct rq *rq, struct task_struct *p, int wakeup)
 			break;
 		cfs_rq = cfs_rq_of(se);
 		enqueue_entity(cfs_rq, se, wakeup);
+		/* the parent entity is off its cfs_rq until unthrottled */
+		if (cfs_rq_throttled(cfs_rq))
+			break;
 		wakeup = 1;
 	}
 
@@ -1042,7 +1218,7 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int sleep)
 		cfs_rq = cfs_rq_of(se);
 		dequeue_entity(cfs_rq, se, sleep);
 		/* Don't dequeue parent if it has other entities besides us */
-		if (cfs_rq->load.weight)
+		if (cfs_rq->load.weight || cfs_rq_throttled(cfs_rq))
 			break;
 		sleep = 1;
 	}
@@ -1642,6 +1818,10 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 	if (unlikely(se == pse))
 		return;
 
+	/* it cannot run before its group is unthrottled */
+	if (unlikely(throttled_hierarchy(pse)))
+		return;
+
 	if (sched_feat(NEXT_BUDDY) && scale && !(wake_flags & WF_FORK))
 		set_next_buddy(pse);
 
@@ -1826,6 +2006,11 @@ load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 		if (!busiest_cfs_rq->task_weight)
 			continue;
 
+		/* the group's quota is shared by all cpus, moving won't help */
+		if (cfs_rq_throttled(busiest_cfs_rq) ||
+		    cfs_rq_throttled(tg->cfs_rq[this_cpu]))
+			continue;
+
 		rem_load = (u64)rem_load_move * busiest_weight;
 		rem_load = div_u64(rem_load, busiest_h_load + 1);
 
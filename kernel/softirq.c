@@ -281,8 +281,12 @@ void irq_enter(void)
 	if (idle_cpu(cpu) && !in_interrupt()) {
 		__irq_enter();
 		tick_check_idle(cpu);
-	} else
+		timer_stats_note_wakeup(1);
+	} else {
+		if (!in_interrupt())
+			timer_stats_note_wakeup(0);
 		__irq_enter();
+	}
 }
 
 #ifdef __ARCH_IRQ_EXIT_IRQS_DISABLED
@@ -31,6 +31,9 @@
  * Display the information collected so far:
  * # cat /proc/timer_stats
  *
+ * Display which of those timers brought a CPU out of idle:
+ * # cat /proc/timer_wakeups
+ *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License version 2 as
  * published by the Free Software Foundation.
@@ -70,6 +73,11 @@ struct entry {
 	unsigned long		count;
 	unsigned int		timer_flag;
 
+	/*
+	 * Number of those events that woke the CPU from idle:
+	 */
+	unsigned long		wakeups;
+
 	/*
 	 * We save the command-line string to preserve
 	 * this information past task exit:
@@ -88,6 +96,13 @@ static DEFINE_SPINLOCK(table_lock);
  */
 static DEFINE_PER_CPU(spinlock_t, lookup_lock);
 
+/*
+ * Set when an interrupt arrives on an idle CPU and cleared by the next one
+ * that does not; the first timer to expire in the idle task's context in
+ * between is charged with the wakeup.
+ */
+static DEFINE_PER_CPU(int, idle_wakeup);
+
 /*
  * Mutex to serialize state changes with show-stats activities:
  */
@@ -258,15 +273,34 @@ void timer_stats_update_stats(void *timer, pid_t pid, void *startf,
 		goto out_unlock;
 
 	entry = tstat_lookup(&input, comm);
-	if (likely(entry))
+	if (likely(entry)) {
 		entry->count++;
-	else
+		if (__get_cpu_var(idle_wakeup) && current->pid == 0 &&
+		    !(timer_flag & TIMER_STATS_FLAG_DEFERRABLE)) {
+			__get_cpu_var(idle_wakeup) = 0;
+			entry->wakeups++;
+		}
+	} else
 		atomic_inc(&overflow_count);
 
  out_unlock:
 	spin_unlock_irqrestore(lock, flags);
 }
 
+/**
+ * timer_stats_note_wakeup - note whether an interrupt woke the CPU
+ * @idle: the interrupt arrived on an idle CPU
+ *
+ * Called from irq_enter() for every interrupt that is not nested.
+ */
+void timer_stats_note_wakeup(int idle)
+{
+	if (likely(!timer_stats_active))
+		return;
+
+	__get_cpu_var(idle_wakeup) = idle;
+}
+
 static void print_name_offset(struct seq_file *m, unsigned long addr)
 {
 	char symname[KSYM_NAME_LEN];
@@ -279,9 +313,10 @@ static void print_name_offset(struct seq_file *m, unsigned long addr)
 
 static int tstats_show(struct seq_file *m, void *v)
 {
+	int show_wakeups = (long)m->private;
 	struct timespec period;
 	struct entry *entry;
-	unsigned long ms;
+	unsigned long ms, count;
 	long events = 0;
 	ktime_t time;
 	int i;
@@ -298,7 +333,10 @@ static int tstats_show(struct seq_file *m, void *v)
 	period = ktime_to_timespec(time);
 	ms = period.tv_nsec / 1000000;
 
-	seq_puts(m, "Timer Stats Version: v0.2\n");
+	if (show_wakeups)
+		seq_puts(m, "Timer Wakeups Version: v0.1\n");
+	else
+		seq_puts(m, "Timer Stats Version: v0.2\n");
 	seq_printf(m, "Sample period: %ld.%03ld s\n", period.tv_sec, ms);
 	if (atomic_read(&overflow_count))
 		seq_printf(m, "Overflow: %d entries\n",
@@ -306,12 +344,15 @@ static int tstats_show(struct seq_file *m, void *v)
 
 	for (i = 0; i < nr_entries; i++) {
 		entry = entries + i;
+		count = show_wakeups ? entry->wakeups : entry->count;
+		if (!count)
+			continue;
  		if (entry->timer_flag & TIMER_STATS_FLAG_DEFERRABLE) {
 			seq_printf(m, "%4luD, %5d %-16s ",
-				entry->count, entry->pid, entry->comm);
+				count, entry->pid, entry->comm);
 		} else {
 			seq_printf(m, " %4lu, %5d %-16s ",
-				entry->count, entry->pid, entry->comm);
+				count, entry->pid, entry->comm);
 		}
 
 		print_name_offset(m, (unsigned long)entry->start_func);
@@ -319,7 +360,7 @@ static int tstats_show(struct seq_file *m, void *v)
 		print_name_offset(m, (unsigned long)entry->expire_func);
 		seq_puts(m, ")\n");
 
-		events += entry->count;
+		events += count;
 	}
 
 	ms += period.tv_sec * 1000;
@@ -327,11 +368,13 @@ static int tstats_show(struct seq_file *m, void *v)
 		ms = 1;
 
 	if (events && period.tv_sec)
-		seq_printf(m, "%ld total events, %ld.%03ld events/sec\n",
-			   events, events * 1000 / ms,
-			   (events * 1000000 / ms) % 1000);
+		seq_printf(m, "%ld total %s, %ld.%03ld %s/sec\n", events,
+			   show_wakeups ? "wakeups" : "events",
+			   events * 1000 / ms, (events * 1000000 / ms) % 1000,
+			   show_wakeups ? "wakeups" : "events");
 	else
-		seq_printf(m, "%ld total events\n", events);
+		seq_printf(m, "%ld total %s\n", events,
+			   show_wakeups ? "wakeups" : "events");
 
 	mutex_unlock(&show_mutex);
 
@@ -395,6 +438,11 @@ static int tstats_open(struct inode *inode, struct file *filp)
 	return single_open(filp, tstats_show, NULL);
 }
 
+static int twakeups_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, tstats_show, (void *)1L);
+}
+
 static const struct file_operations tstats_fops = {
 	.open		= tstats_open,
 	.read		= seq_read,
@@ -403,6 +451,13 @@ static const struct file_operations tstats_fops = {
 	.release	= single_release,
 };
 
+static const struct file_operations twakeups_fops = {
+	.open		= twakeups_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void __init init_timer_stats(void)
 {
 	int cpu;
@@ -416,6 +471,9 @@ static int __init init_tstats_procfs(void)
 	struct proc_dir_entry *pe;
 
 	pe = proc_create("timer_stats", 0644, NULL, &tstats_fops);
+	if (!pe)
+		return -ENOMEM;
+	pe = proc_create("timer_wakeups", 0444, NULL, &twakeups_fops);
 	if (!pe)
 		return -ENOMEM;
 	return 0;
@@ -17,4 +17,4 @@
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_start);
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_end);
 EXPORT_TRACEPOINT_SYMBOL_GPL(power_frequency);
-
+EXPORT_TRACEPOINT_SYMBOL_GPL(suspend_sync);
@@ -0,0 +1,585 @@
+/*
+ * cleancache - compressed in-memory copies of evicted clean file pages
+ *
+ * This file is released under the GPLv2.
+ *
+ * When reclaim drops a clean page of a regular file, the page is
+ * LZO-compressed and kept here, keyed by its mapping and index.  The next
+ * time that page is read into the page cache it is decompressed instead of
+ * being read from flash, which is what makes relaunching a recently killed
+ * app cheap.  A copy is only a hint: it is dropped whenever the page could
+ * have changed without passing through the page cache (truncation,
+ * invalidation, direct I/O) or the inode goes away, and a hit removes it,
+ * since the page cache holds the data again from then on.
+ *
+ * Copies live in kmalloc'd entries on an rbtree and an LRU list.  The pool
+ * is limited to max_pool_percent of RAM and shrinks under memory pressure
+ * through its own shrinker, oldest entry first.
+ *
+ * Pages are put under the mapping's tree_lock with interrupts off, which
+ * is no place for LZO.  The page is only copied there and queued; a worker
+ * compresses the queued copies later, and nothing else that takes cc_lock
+ * (with interrupts disabled) ever sleeps or compresses.  A copy that is
+ * flushed while it waits is dropped before it reaches the rbtree.
+ */
+
+#include <linux/cleancache.h>
+#include <linux/highmem.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/lzo.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/rbtree.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/swap.h>
+#include <linux/workqueue.h>
+
+/* Pages compressing worse than this are not worth keeping. */
+#define CC_MAX_SIZE	(PAGE_SIZE / 4 * 3)
+
+/* Uncompressed copies waiting for the worker; more are rejected. */
+#define CC_MAX_PENDING	32
+
+/*
+ * Allocations happen from reclaim, or while memory is short right after
+ * it: never wait, and never eat into the reserves that PF_MEMALLOC would
+ * otherwise give us.
+ */
+#define CC_GFP		(GFP_NOWAIT | __GFP_NORETRY | __GFP_NOWARN | \
+			 __GFP_NOMEMALLOC)
+
+struct cc_entry {
+	struct rb_node rb;
+	struct list_head lru;
+	struct address_space *mapping;
+	pgoff_t index;
+	unsigned int size;
+	unsigned char data[0];
+};
+
+struct cc_pending {
+	struct list_head list;
+	struct address_space *mapping;
+	pgoff_t index;
+	struct page *copy;
+	int cancelled;
+};
+
+int cleancache_enabled __read_mostly;
+
+static DEFINE_SPINLOCK(cc_lock);
+static struct rb_root cc_root = RB_ROOT;
+static LIST_HEAD(cc_lru);		/* oldest first */
+
+static LIST_HEAD(cc_pending_list);	/* oldest first */
+static unsigned int cc_nr_pending;
+static struct cc_pending *cc_compressing;	/* off the list, in the worker */
+
+/* LZO buffers, used under cc_compress_mutex */
+static DEFINE_MUTEX(cc_compress_mutex);
+static void *cc_workmem;
+static unsigned char *cc_buffer;
+
+static void cc_compress_work(struct work_struct *work);
+static DECLARE_WORK(cc_work, cc_compress_work);
+
+static unsigned int cc_max_pool_percent = 10;
+
+static unsigned long cc_stored_pages;
+static unsigned long cc_compr_bytes;
+static unsigned long cc_puts;
+static unsigned long cc_rejects;
+static unsigned long cc_hits;
+static unsigned long cc_misses;
+static unsigned long cc_flushes;
+static unsigned long cc_evicts;
+
+static int cc_cmp(struct address_space *mapping, pgoff_t index,
+		  struct cc_entry *entry)
+{
+	if (mapping != entry->mapping)
+		return mapping < entry->mapping ? -1 : 1;
+	if (index != entry->index)
+		return index < entry->index ? -1 : 1;
+	return 0;
+}
+
+static struct cc_entry *cc_lookup(struct address_space *mapping,
+				  pgoff_t index)
+{
+	struct rb_node *node = cc_root.rb_node;
+
+	while (node) {
+		struct cc_entry *entry = rb_entry(node, struct cc_entry, rb);
+		int cmp = cc_cmp(mapping, index, entry);
+
+		if (cmp < 0)
+			node = node->rb_left;
+		else if (cmp > 0)
+			node = node->rb_right;
+		else
+			return entry;
+	}
+	return NULL;
+}
+
+static void cc_erase(struct cc_entry *entry)
+{
+	rb_erase(&entry->rb, &cc_root);
+	list_del(&entry->lru);
+	cc_stored_pages--;
+	cc_compr_bytes -= entry->size;
+	kfree(entry);
+}
+
+/* Insert @new, replacing an entry for the same page. */
+static void cc_insert(struct cc_entry *new)
+{
+	struct rb_node **link = &cc_root.rb_node, *parent = NULL;
+
+	while (*link) {
+		struct cc_entry *entry = rb_entry(*link, struct cc_entry, rb);
+		int cmp = cc_cmp(new->mapping, new->index, entry);
+
+		parent = *link;
+		if (cmp < 0) {
+			link = &parent->rb_left;
+		} else if (cmp > 0) {
+			link = &parent->rb_right;
+		} else {
+			rb_replace_node(&entry->rb, &new->rb, &cc_root);
+			list_del(&entry->lru);
+			cc_stored_pages--;
+			cc_compr_bytes -= entry->size;
+			kfree(entry);
+			goto out;
+		}
+	}
+	rb_link_node(&new->rb, parent, link);
+	rb_insert_color(&new->rb, &cc_root);
+out:
+	list_add_tail(&new->lru, &cc_lru);
+	cc_stored_pages++;
+	cc_compr_bytes += new->size;
+}
+
+static void cc_evict(unsigned long nr)
+{
+	while (nr-- && !list_empty(&cc_lru)) {
+		cc_erase(list_first_entry(&cc_lru, struct cc_entry, lru));
+		cc_evicts++;
+	}
+}
+
+static void cc_evict_over_limit(void)
+{
+	unsigned long max_bytes;
+
+	max_bytes = (totalram_pages * cc_max_pool_percent / 100) << PAGE_SHIFT;
+	while (cc_compr_bytes > max_bytes && !list_empty(&cc_lru)) {
+		cc_erase(list_first_entry(&cc_lru, struct cc_entry, lru));
+		cc_evicts++;
+	}
+}
+
+static void cc_free_pending(struct cc_pending *p)
+{
+	__free_page(p->copy);
+	kfree(p);
+}
+
+/*
+ * Drop the queued copies of @mapping, only that of @index unless @whole is
+ * set, or of every mapping if @mapping is NULL.  The copy the worker is
+ * compressing is only marked; the worker drops it when it is done.
+ */
+static void cc_cancel_pending(struct address_space *mapping, pgoff_t index,
+			      int whole)
+{
+	struct cc_pending *p, *next;
+
+	list_for_each_entry_safe(p, next, &cc_pending_list, list) {
+		if (mapping && (p->mapping != mapping ||
+				(!whole && p->index != index)))
+			continue;
+		list_del(&p->list);
+		cc_nr_pending--;
+		cc_free_pending(p);
+		cc_flushes++;
+	}
+
+	p = cc_compressing;
+	if (p && !p->cancelled && (!mapping || (p->mapping == mapping &&
+					       (whole || p->index == index)))) {
+		p->cancelled = 1;
+		cc_flushes++;
+	}
+}
+
+/**
+ * __cleancache_put_page - keep a compressed copy of a clean page
+ * @mapping: the mapping @page is leaving
+ * @page: the page, still locked and in the page cache
+ *
+ * Only copies the page; it is compressed by cc_compress_work().
+ */
+void __cleancache_put_page(struct address_space *mapping, struct page *page)
+{
+	struct cc_pending *p = NULL;
+	struct cc_entry *entry;
+	unsigned long flags;
+
+	if (cc_nr_pending < CC_MAX_PENDING) {
+		p = kmalloc(sizeof(*p), CC_GFP);
+		if (p) {
+			p->copy = alloc_page(CC_GFP);
+			if (!p->copy) {
+				kfree(p);
+				p = NULL;
+			}
+		}
+	}
+	if (p) {
+		copy_highpage(p->copy, page);
+		p->mapping = mapping;
+		p->index = page->index;
+		p->cancelled = 0;
+	}
+
+	spin_lock_irqsave(&cc_lock, flags);
+
+	/* an older copy would be stale now */
+	cc_cancel_pending(mapping, page->index, 0);
+	entry = cc_lookup(mapping, page->index);
+	if (entry)
+		cc_erase(entry);
+
+	if (p && cc_nr_pending < CC_MAX_PENDING) {
+		list_add_tail(&p->list, &cc_pending_list);
+		cc_nr_pending++;
+		p = NULL;
+		schedule_work(&cc_work);
+	} else {
+		cc_rejects++;
+	}
+
+	spin_unlock_irqrestore(&cc_lock, flags);
+
+	if (p)
+		cc_free_pending(p);
+}
+
+/* Compress the queued copies and add them to the rbtree. */
+static void cc_compress_work(struct work_struct *work)
+{
+	struct cc_pending *p;
+	struct cc_entry *entry;
+	unsigned char *src;
+	size_t clen;
+	int ret;
+
+	mutex_lock(&cc_compress_mutex);
+	for (;;) {
+		spin_lock_irq(&cc_lock);
+		if (list_empty(&cc_pending_list)) {
+			spin_unlock_irq(&cc_lock);
+			break;
+		}
+		p = list_first_entry(&cc_pending_list, struct cc_pending, list);
+		list_del(&p->list);
+		cc_nr_pending--;
+		cc_compressing = p;
+		spin_unlock_irq(&cc_lock);
+
+		src = kmap(p->copy);
+		ret = lzo1x_1_compress(src, PAGE_SIZE, cc_buffer, &clen,
+				       cc_workmem);
+		kunmap(p->copy);
+
+		entry = NULL;
+		if (ret == LZO_E_OK && clen <= CC_MAX_SIZE)
+			entry = kmalloc(sizeof(*entry) + clen, CC_GFP);
+		if (entry) {
+			entry->mapping = p->mapping;
+			entry->index = p->index;
+			entry->size = clen;
+			memcpy(entry->data, cc_buffer, clen);
+		}
+
+		spin_lock_irq(&cc_lock);
+		cc_compressing = NULL;
+		if (!p->cancelled && entry) {
+			cc_insert(entry);
+			cc_puts++;
+			cc_evict_over_limit();
+			entry = NULL;
+		} else if (!p->cancelled) {
+			cc_rejects++;
+		}
+		spin_unlock_irq(&cc_lock);
+
+		kfree(entry);
+		cc_free_pending(p);
+		cond_resched();
+	}
+	mutex_unlock(&cc_compress_mutex);
+}
+
+/**
+ * __cleancache_get_page - fill a page from its compressed copy
+ * @page: locked page, newly added to the page cache
+ *
+ * Returns 0 with @page up to date if there was a copy, which is then
+ * dropped; -1 if the page must be read as usual.
+ */
+int __cleancache_get_page(struct page *page)
+{
+	struct cc_entry *entry;
+	unsigned long flags;
+	unsigned char *dst;
+	size_t dlen = PAGE_SIZE;
+	int ret;
+
+	if (!cc_stored_pages && !cc_nr_pending)
+		return -1;
+
+	spin_lock_irqsave(&cc_lock, flags);
+	/* a copy still waiting to be compressed is no use now */
+	cc_cancel_pending(page->mapping, page->index, 0);
+	entry = cc_lookup(page->mapping, page->index);
+	if (!entry) {
+		cc_misses++;
+		spin_unlock_irqrestore(&cc_lock, flags);
+		return -1;
+	}
+
+	dst = kmap_atomic(page, KM_USER0);
+	ret = lzo1x_decompress_safe(entry->data, entry->size, dst, &dlen);
+	kunmap_atomic(dst, KM_USER0);
+	cc_erase(entry);
+	if (ret != LZO_E_OK || dlen != PAGE_SIZE) {
+		cc_misses++;
+		spin_unlock_irqrestore(&cc_lock, flags);
+		return -1;
+	}
+	cc_hits++;
+	spin_unlock_irqrestore(&cc_lock, flags);
+
+	flush_dcache_page(page);
+	/* it was put with all its blocks on disk, and still has them */
+	SetPageMappedToDisk(page);
+	SetPageUptodate(page);
+	return 0;
+}
+
+/**
+ * __cleancache_flush_page - drop the copy of a page, if any
+ * @mapping: the page's mapping
+ * @page: the page
+ */
+void __cleancache_flush_page(struct address_space *mapping, struct page *page)
+{
+	struct cc_entry *entry;
+	unsigned long flags;
+
+	if (!cc_stored_pages && !cc_nr_pending)
+		return;
+
+	spin_lock_irqsave(&cc_lock, flags);
+	cc_cancel_pending(mapping, page->index, 0);
+	entry = cc_lookup(mapping, page->index);
+	if (entry) {
+		cc_erase(entry);
+		cc_flushes++;
+	}
+	spin_unlock_irqrestore(&cc_lock, flags);
+}
+
+/**
+ * __cleancache_flush_inode - drop the copies of all pages of a mapping
+ * @mapping: the mapping
+ */
+void __cleancache_flush_inode(struct address_space *mapping)
+{
+	struct cc_entry *entry, *first = NULL;
+	struct rb_node *node;
+	unsigned long flags;
+
+	if (!cc_stored_pages && !cc_nr_pending)
+		return;
+
+	spin_lock_irqsave(&cc_lock, flags);
+	cc_cancel_pending(mapping, 0, 1);
+
+	/* find the entry with the lowest index in @mapping */
+	node = cc_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct cc_entry, rb);
+		if (cc_cmp(mapping, 0, entry) <= 0) {
+			if (entry->mapping == mapping)
+				first = entry;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	while (first) {
+		node = rb_next(&first->rb);
+		cc_erase(first);
+		cc_flushes++;
+		first = node ? rb_entry(node, struct cc_entry, rb) : NULL;
+		if (first && first->mapping != mapping)
+			break;
+	}
+
+	spin_unlock_irqrestore(&cc_lock, flags);
+}
+
+static void cc_flush_all(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cc_lock, flags);
+	cc_cancel_pending(NULL, 0, 1);
+	cc_evict(ULONG_MAX);
+	spin_unlock_irqrestore(&cc_lock, flags);
+}
+
+static int cc_shrink(int nr_to_scan, gfp_t gfp_mask)
+{
+	unsigned long flags;
+
+	if (nr_to_scan) {
+		spin_lock_irqsave(&cc_lock, flags);
+		cc_evict(nr_to_scan);
+		spin_unlock_irqrestore(&cc_lock, flags);
+	}
+	return cc_stored_pages;
+}
+
+static struct shrinker cc_shrinker = {
+	.shrink = cc_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+#ifdef CONFIG_SYSFS
+/*
+ * This all compiles without CONFIG_SYSFS, but is a waste of space.
+ */
+
+#define CC_ATTR_RO(_name) \
+	static struct kobj_attribute _name##_attr = __ATTR_RO(_name)
+#define CC_ATTR(_name) \
+	static struct kobj_attribute _name##_attr = \
+		__ATTR(_name, 0644, _name##_show, _name##_store)
+
+static ssize_t enabled_show(struct kobject *kobj,
+			    struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", cleancache_enabled);
+}
+
+static ssize_t enabled_store(struct kobject *kobj,
+			     struct kobj_attribute *attr,
+			     const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 10, &val) || val > 1)
+		return -EINVAL;
+
+	cleancache_enabled = val;
+	if (!val)
+		cc_flush_all();
+
+	return count;
+}
+CC_ATTR(enabled);
+
+static ssize_t max_pool_percent_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", cc_max_pool_percent);
+}
+
+static ssize_t max_pool_percent_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t count)
+{
+	unsigned long flags, val;
+
+	if (strict_strtoul(buf, 10, &val) || val > 100)
+		return -EINVAL;
+
+	spin_lock_irqsave(&cc_lock, flags);
+	cc_max_pool_percent = val;
+	cc_evict_over_limit();
+	spin_unlock_irqrestore(&cc_lock, flags);
+
+	return count;
+}
+CC_ATTR(max_pool_percent);
+
+#define CC_STAT_ATTR(_name, _var)					\
+static ssize_t _name##_show(struct kobject *kobj,			\
+			    struct kobj_attribute *attr, char *buf)	\
+{									\
+	return sprintf(buf, "%lu\n", _var);				\
+}									\
+CC_ATTR_RO(_name)
+
+CC_STAT_ATTR(stored_pages, cc_stored_pages);
+CC_STAT_ATTR(compr_data_size, cc_compr_bytes);
+CC_STAT_ATTR(puts, cc_puts);
+CC_STAT_ATTR(rejects, cc_rejects);
+CC_STAT_ATTR(hits, cc_hits);
+CC_STAT_ATTR(misses, cc_misses);
+CC_STAT_ATTR(flushes, cc_flushes);
+CC_STAT_ATTR(evicts, cc_evicts);
+
+static struct attribute *cc_attrs[] = {
+	&enabled_attr.attr,
+	&max_pool_percent_attr.attr,
+	&stored_pages_attr.attr,
+	&compr_data_size_attr.attr,
+	&puts_attr.attr,
+	&rejects_attr.attr,
+	&hits_attr.attr,
+	&misses_attr.attr,
+	&flushes_attr.attr,
+	&evicts_attr.attr,
+	NULL,
+};
+
+static struct attribute_group cc_attr_group = {
+	.attrs = cc_attrs,
+	.name = "cleancache",
+};
+#endif /* CONFIG_SYSFS */
+
+static int __init cleancache_init(void)
+{
+	cc_workmem = kmalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+	cc_buffer = kmalloc(lzo1x_worst_compress(PAGE_SIZE), GFP_KERNEL);
+	if (!cc_workmem || !cc_buffer) {
+		kfree(cc_workmem);
+		kfree(cc_buffer);
+		printk(KERN_ERR "cleancache: out of memory\n");
+		return -ENOMEM;
+	}
+
+#ifdef CONFIG_SYSFS
+	if (sysfs_create_group(mm_kobj, &cc_attr_group))
+		printk(KERN_ERR "cleancache: register sysfs failed\n");
+#endif
+
+	register_shrinker(&cc_shrinker);
+	cleancache_enabled = 1;
+	return 0;
+}
+module_init(cleancache_init)
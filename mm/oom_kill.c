@@ -32,6 +32,43 @@ int sysctl_panic_on_oom;
 int sysctl_oom_kill_allocating_task;
 int sysctl_oom_dump_tasks;
 static DEFINE_SPINLOCK(zone_scan_lock);
+
+#ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER
+DEFINE_SPINLOCK(oom_adj_lock);
+struct hlist_head oom_adj_buckets[OOM_ADJ_BUCKETS];
+
+/*
+ * Called for a new thread group once it is on the tasklist, under
+ * tasklist_lock.
+ */
+void oom_adj_add(struct signal_struct *sig)
+{
+	spin_lock(&oom_adj_lock);
+	hlist_add_head(&sig->oom_adj_node,
+		       &oom_adj_buckets[sig->oom_adj - OOM_DISABLE]);
+	spin_unlock(&oom_adj_lock);
+}
+
+/* Called when the last thread of the group is released. */
+void oom_adj_del(struct signal_struct *sig)
+{
+	spin_lock(&oom_adj_lock);
+	hlist_del_init(&sig->oom_adj_node);
+	spin_unlock(&oom_adj_lock);
+}
+
+/* Called under ->siglock after sig->oom_adj has changed. */
+void oom_adj_update(struct signal_struct *sig)
+{
+	spin_lock(&oom_adj_lock);
+	if (!hlist_unhashed(&sig->oom_adj_node)) {
+		hlist_del(&sig->oom_adj_node);
+		hlist_add_head(&sig->oom_adj_node,
+			       &oom_adj_buckets[sig->oom_adj - OOM_DISABLE]);
+	}
+	spin_unlock(&oom_adj_lock);
+}
+#endif
 /* #define DEBUG */
 
 /*
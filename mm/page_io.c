@@ -17,6 +17,7 @@
 #include <linux/bio.h>
 #include <linux/swapops.h>
 #include <linux/writeback.h>
+#include <linux/highmem.h>
 #include <asm/pgtable.h>
 
 static struct bio *get_swap_bio(gfp_t gfp_flags, pgoff_t index,
@@ -89,12 +90,56 @@ void end_swap_bio_read(struct bio *bio, int err)
 	bio_put(bio);
 }
 
+/*
+ * Anonymous pages that are all zeroes, or one word repeated, are common
+ * (fresh heaps, cleared buffers).  Rather than writing them out, remember
+ * the word in the swap area and fill the page with it on swap-in.
+ */
+static int page_same_filled(struct page *page, unsigned long *value)
+{
+	unsigned long *data;
+	unsigned int pos, last = PAGE_SIZE / sizeof(*data) - 1;
+	int ret = 0;
+
+	data = kmap_atomic(page, KM_USER0);
+	/* most pages that are not same-filled differ at either end */
+	if (data[last] != data[0])
+		goto out;
+	for (pos = 1; pos < last; pos++) {
+		if (data[pos] != data[0])
+			goto out;
+	}
+	*value = data[0];
+	ret = 1;
+out:
+	kunmap_atomic(data, KM_USER0);
+	return ret;
+}
+
+static void fill_page(struct page *page, unsigned long value)
+{
+	unsigned long *data;
+	unsigned int pos;
+
+	data = kmap_atomic(page, KM_USER0);
+	if (!value)
+		memset(data, 0, PAGE_SIZE);
+	else
+		for (pos = 0; pos < PAGE_SIZE / sizeof(*data); pos++)
+			data[pos] = value;
+	kunmap_atomic(data, KM_USER0);
+	flush_dcache_page(page);
+}
+
 /*
  * We may have stale swap cache pages in memory: notice
  * them here and get rid of the unnecessary final write.
  */
 int swap_writepage(struct page *page, struct writeback_control *wbc)
 {
+	swp_entry_t entry = { .val = page_private(page), };
+	struct swap_info_struct *sis;
+	unsigned long value;
 	struct bio *bio;
 	int ret = 0, rw = WRITE;
 
@@ -102,6 +147,20 @@ int swap_writepage(struct page *page, struct writeback_control *wbc)
 		unlock_page(page);
 		goto out;
 	}
+
+	sis = get_swap_info_struct(swp_type(entry));
+	if (page_same_filled(page, &value)) {
+		sis->fill_value[swp_offset(entry)] = value;
+		set_bit(swp_offset(entry), sis->same_filled);
+		count_vm_event(PSWPOUT_SAME_FILLED);
+		set_page_writeback(page);
+		unlock_page(page);
+		end_page_writeback(page);
+		goto out;
+	}
+	/* the slot may have held a same-filled page before */
+	clear_bit(swp_offset(entry), sis->same_filled);
+
 	bio = get_swap_bio(GFP_NOIO, page_private(page), page,
 				end_swap_bio_write);
 	if (bio == NULL) {
@@ -122,11 +181,23 @@ out:
 
 int swap_readpage(struct page *page)
 {
+	swp_entry_t entry = { .val = page_private(page), };
+	struct swap_info_struct *sis;
 	struct bio *bio;
 	int ret = 0;
 
 	VM_BUG_ON(!PageLocked(page));
 	VM_BUG_ON(PageUptodate(page));
+
+	sis = get_swap_info_struct(swp_type(entry));
+	if (test_bit(swp_offset(entry), sis->same_filled)) {
+		fill_page(page, sis->fill_value[swp_offset(entry)]);
+		count_vm_event(PSWPIN_SAME_FILLED);
+		SetPageUptodate(page);
+		unlock_page(page);
+		goto out;
+	}
+
 	bio = get_swap_bio(GFP_KERNEL, page_private(page), page,
 				end_swap_bio_read);
 	if (bio == NULL) {
@@ -585,6 +585,13 @@ static int swap_entry_free(struct swap_info_struct *p,
 			swap_list.next = p - swap_info;
 		nr_swap_pages++;
 		p->inuse_pages--;
+		clear_bit(offset, p->same_filled);
+		if (p->flags & SWP_BLKDEV) {
+			struct gendisk *disk = p->bdev->bd_disk;
+			if (disk->fops->swap_slot_free_notify)
+				disk->fops->swap_slot_free_notify(p->bdev,
+								  offset);
+		}
 	}
 	if (!swap_count(count))
 		mem_cgroup_uncharge_swap(ent);
@@ -1511,6 +1518,7 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 {
 	struct swap_info_struct * p = NULL;
 	unsigned short *swap_map;
+	unsigned long *same_filled, *fill_value;
 	struct file *swap_file, *victim;
 	struct address_space *mapping;
 	struct inode *inode;
@@ -1623,10 +1631,16 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->max = 0;
 	swap_map = p->swap_map;
 	p->swap_map = NULL;
+	same_filled = p->same_filled;
+	p->same_filled = NULL;
+	fill_value = p->fill_value;
+	p->fill_value = NULL;
 	p->flags = 0;
 	spin_unlock(&swap_lock);
 	mutex_unlock(&swapon_mutex);
 	vfree(swap_map);
+	vfree(same_filled);
+	vfree(fill_value);
 	/* Destroy swap account informatin */
 	swap_cgroup_swapoff(type);
 
@@ -1780,6 +1794,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	unsigned long maxpages = 1;
 	unsigned long swapfilepages;
 	unsigned short *swap_map = NULL;
+	unsigned long *same_filled = NULL;
+	unsigned long *fill_value = NULL;
 	struct page *page = NULL;
 	struct inode *inode = NULL;
 	int did_down = 0;
@@ -1839,6 +1855,7 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			error = -EINVAL;
 			goto bad_swap;
 		}
+		p->flags |= SWP_BLKDEV;
 		p->old_block_size = block_size(bdev);
 		error = set_blocksize(bdev, PAGE_SIZE);
 		if (error < 0)
@@ -1939,6 +1956,16 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	}
 
 	memset(swap_map, 0, maxpages * sizeof(short));
+
+	/* same-filled pages are kept here instead of being written out */
+	same_filled = vmalloc(BITS_TO_LONGS(maxpages) * sizeof(long));
+	fill_value = vmalloc(maxpages * sizeof(long));
+	if (!same_filled || !fill_value) {
+		error = -ENOMEM;
+		goto bad_swap;
+	}
+	memset(same_filled, 0, BITS_TO_LONGS(maxpages) * sizeof(long));
+
 	for (i = 0; i < swap_header->info.nr_badpages; i++) {
 		int page_nr = swap_header->info.badpages[i];
 		if (page_nr <= 0 || page_nr >= swap_header->info.last_page) {
@@ -1990,6 +2017,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	else
 		p->prio = --least_priority;
 	p->swap_map = swap_map;
+	p->same_filled = same_filled;
+	p->fill_value = fill_value;
 	p->flags |= SWP_WRITEOK;
 	nr_swap_pages += nr_good_pages;
 	total_swap_pages += nr_good_pages;
@@ -2032,6 +2061,8 @@ bad_swap_2:
 	p->flags = 0;
 	spin_unlock(&swap_lock);
 	vfree(swap_map);
+	vfree(same_filled);
+	vfree(fill_value);
 	if (swap_file)
 		filp_close(swap_file, NULL);
 out:
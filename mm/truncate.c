@@ -16,6 +16,7 @@
 #include <linux/highmem.h>
 #include <linux/pagevec.h>
 #include <linux/task_io_accounting_ops.h>
+#include <linux/cleancache.h>
 #include <linux/buffer_head.h>	/* grr. try_to_release_page,
 				   do_invalidatepage */
 #include "internal.h"
@@ -105,8 +106,9 @@ truncate_complete_page(struct address_space *mapping, struct page *page)
 	cancel_dirty_page(page, PAGE_CACHE_SIZE);
 
 	clear_page_mlock(page);
-	remove_from_page_cache(page);
+	/* before removal, so cleancache does not keep it */
 	ClearPageMappedToDisk(page);
+	remove_from_page_cache(page);
 	page_cache_release(page);	/* pagecache ref */
 	return 0;
 }
@@ -181,6 +183,49 @@ int invalidate_inode_page(struct page *page)
 	return invalidate_complete_page(mapping, page);
 }
 
+/**
+ * clear_shadow_entries - drop the shadow entries of evicted pages
+ * @mapping: mapping to clean up
+ * @start: first page index
+ * @end: last page index, inclusive
+ *
+ * Remove the entries that reclaim left behind in @mapping's tree for the
+ * pages it evicted from the given range (see mm/workingset.c).  Pages in
+ * the range are not touched.
+ */
+void clear_shadow_entries(struct address_space *mapping,
+			  pgoff_t start, pgoff_t end)
+{
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	unsigned long shadows[PAGEVEC_SIZE];
+	unsigned int i, nr, nr_shadows;
+
+	while (start <= end) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots,
+						 indices, start, PAGEVEC_SIZE);
+		nr_shadows = 0;
+		for (i = 0; i < nr && indices[i] <= end; i++) {
+			void *entry = radix_tree_deref_slot(slots[i]);
+
+			if (radix_tree_exceptional_entry(entry))
+				shadows[nr_shadows++] = indices[i];
+		}
+		/* slots[] is stale once the tree starts shrinking */
+		for (i = 0; i < nr_shadows; i++)
+			radix_tree_delete(&mapping->page_tree, shadows[i]);
+		spin_unlock_irq(&mapping->tree_lock);
+
+		if (!nr)
+			break;
+		start = indices[nr - 1] + 1;
+		if (!start)
+			break;
+		cond_resched();
+	}
+}
+
 /**
  * truncate_inode_pages - truncate range of pages specified by start & end byte offsets
  * @mapping: mapping to truncate
@@ -214,11 +259,12 @@ void truncate_inode_pages_range(struct address_space *mapping,
 	pgoff_t next;
 	int i;
 
+	cleancache_flush_inode(mapping);
+	end = (lend >> PAGE_CACHE_SHIFT);
 	if (mapping->nrpages == 0)
-		return;
+		goto out;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
-	end = (lend >> PAGE_CACHE_SHIFT);
 
 	pagevec_init(&pvec, 0);
 	next = start;
@@ -287,6 +333,10 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		}
 		pagevec_release(&pvec);
 	}
+out:
+	if (mapping->page_tree.rnode)
+		clear_shadow_entries(mapping, start, end);
+	cleancache_flush_inode(mapping);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
 
@@ -382,6 +432,7 @@ invalidate_complete_page2(struct address_space *mapping, struct page *page)
 
 	clear_page_mlock(page);
 	BUG_ON(page_has_private(page));
+	ClearPageMappedToDisk(page);
 	__remove_from_page_cache(page);
 	spin_unlock_irq(&mapping->tree_lock);
 	mem_cgroup_uncharge_cache_page(page);
@@ -479,6 +530,7 @@ int invalidate_inode_pages2_range(struct address_space *mapping,
 		pagevec_release(&pvec);
 		cond_resched();
 	}
+	cleancache_flush_inode(mapping);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(invalidate_inode_pages2_range);
@@ -661,6 +661,10 @@ static const char * const vmstat_text[] = {
 	"pgpgout",
 	"pswpin",
 	"pswpout",
+	"pswpin_same_filled",
+	"pswpout_same_filled",
+	"workingset_refault",
+	"workingset_activate",
 
 	TEXTS_FOR_ZONES("pgalloc")
 
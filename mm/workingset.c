@@ -0,0 +1,121 @@
+/*
+ * Workingset detection
+ *
+ * This file is released under the GPLv2.
+ *
+ * The two LRU lists cannot tell a page that is evicted and read back soon
+ * after from one that is never used again: both start over at the head of
+ * the inactive list, and a working set that is a little larger than the
+ * inactive list thrashes there without ever being activated.
+ *
+ * To catch this, each zone counts the pages leaving its inactive file
+ * list, either evicted or activated, in zone->inactive_age.  When reclaim
+ * evicts a page it leaves the current count in the page's radix tree slot
+ * as an exceptional "shadow" entry.  When the page is faulted back in, the
+ * difference between the count then and the count in the shadow is the
+ * refault distance: the number of inactive pages that left the list while
+ * the page was out, which is the least amount of extra inactive list space
+ * that would have kept it in memory.
+ *
+ * That space can only come from the active list, so if the refault
+ * distance is no larger than the number of active file pages, the page
+ * would have survived had the active pages made room for it.  Such a page
+ * is put straight on the active list, where it competes with the current
+ * active pages instead of being evicted again.  Refaults whose distance is
+ * larger are treated as new pages.
+ *
+ * Shadow entries are dropped when the page range is truncated or the
+ * inode is freed; there is no separate reclaim of them.
+ *
+ * The refaults and activations are counted as workingset_refault and
+ * workingset_activate in /proc/vmstat.
+ */
+
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/radix-tree.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+#include <asm/atomic.h>
+
+#define EVICTION_SHIFT	(RADIX_TREE_EXCEPTIONAL_SHIFT + \
+			 ZONES_SHIFT + NODES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << RADIX_TREE_EXCEPTIONAL_SHIFT);
+
+	return (void *)(eviction | RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *evictionp)
+{
+	unsigned long entry = (unsigned long)shadow;
+	int zid, nid;
+
+	entry >>= RADIX_TREE_EXCEPTIONAL_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*evictionp = entry;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Returns a shadow entry to be stored in @mapping's tree in place of
+ * @page.  Called with the mapping's tree_lock held.
+ */
+void *workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	return pack_shadow(eviction, zone);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Returns 1 if the page should be activated, 0 otherwise.
+ */
+int workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	unsigned long eviction;
+	unsigned long refault;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &eviction);
+	refault = atomic_long_read(&zone->inactive_age);
+	refault_distance = (refault - eviction) & EVICTION_MASK;
+
+	count_vm_event(WORKINGSET_REFAULT);
+
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		count_vm_event(WORKINGSET_ACTIVATE);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}